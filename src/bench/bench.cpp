@@ -0,0 +1,246 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+// Renders a scene headless along a scripted camera path and reports frame time percentiles as JSON.
+// usage: sirius-bench <scene.glb> [--frames N] [--warmup N] [--path camera_path.txt] [--width W] [--height H] [--out result.json] [--trace trace.json]
+// Without --out the JSON is the only thing written to stdout, everything the renderer prints goes to stderr
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+#include <fmt/os.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "core/profiler.h"
+#include "core/utils.h"
+#include "graphics/camera_path.h"
+#include "graphics/vkRenderer.h"
+
+namespace {
+struct BenchOptions {
+    std::string scenePath = "../../resources/structure.glb";
+    std::string cameraPath;
+    std::string outPath;
+    std::string tracePath;
+    int frames = 500;
+    int warmup = 30;
+    uint32_t width = 1920;
+    uint32_t height = 1080;
+};
+
+struct Percentiles {
+    double p50;
+    double p95;
+    double p99;
+    double mean;
+    double max;
+};
+
+bool ParseArguments(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--frames") == 0 && hasValue) {
+            options.frames = std::stoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) {
+            options.warmup = std::stoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--path") == 0 && hasValue) {
+            options.cameraPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--width") == 0 && hasValue) {
+            options.width = std::stoul(argv[++i]);
+        } else if (std::strcmp(argv[i], "--height") == 0 && hasValue) {
+            options.height = std::stoul(argv[++i]);
+        } else if (std::strcmp(argv[i], "--out") == 0 && hasValue) {
+            options.outPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--trace") == 0 && hasValue) {
+            options.tracePath = argv[++i];
+        } else if (argv[i][0] != '-') {
+            options.scenePath = argv[i];
+        } else {
+            return false;
+        }
+    }
+    return options.frames > 0 && options.warmup >= 0;
+}
+
+// Slow loop through the middle of the scene, used when no recorded path is given
+sirius::CameraPath DefaultCameraPath() {
+    sirius::CameraPath path;
+    path.AddKeyframe({0.0f, {0.0f, 2.0f, 0.0f}, 0.0f, 0.0f});
+    path.AddKeyframe({2.0f, {8.0f, 3.0f, 4.0f}, -0.2f, 1.2f});
+    path.AddKeyframe({4.0f, {0.0f, 6.0f, 10.0f}, -0.5f, 3.1f});
+    path.AddKeyframe({6.0f, {-8.0f, 3.0f, 4.0f}, -0.2f, 4.8f});
+    path.AddKeyframe({8.0f, {0.0f, 2.0f, 0.0f}, 0.0f, 6.28f});
+    return path;
+}
+
+// Nearest rank percentiles
+Percentiles ComputePercentiles(std::vector<double> values) {
+    if (values.empty()) {
+        return {};
+    }
+    std::ranges::sort(values);
+
+    auto rank = [&values](double percentile) {
+        const auto index = static_cast<size_t>(std::ceil(percentile / 100.0 * static_cast<double>(values.size()))) - 1;
+        return values[std::min(index, values.size() - 1)];
+    };
+
+    double sum = 0.0;
+    for (double value : values) {
+        sum += value;
+    }
+
+    return {rank(50.0), rank(95.0), rank(99.0), sum / static_cast<double>(values.size()), values.back()};
+}
+
+// Points stdout at stderr and returns a stream on the original stdout, for the report
+FILE* DivertStdoutToStderr() {
+    std::cout.flush();
+    std::fflush(stdout);
+#ifdef _WIN32
+    const int reportFd = _dup(_fileno(stdout));
+    if (reportFd < 0 || _dup2(_fileno(stderr), _fileno(stdout)) != 0) {
+        return nullptr;
+    }
+    return _fdopen(reportFd, "w");
+#else
+    const int reportFd = dup(fileno(stdout));
+    if (reportFd < 0 || dup2(fileno(stderr), fileno(stdout)) < 0) {
+        return nullptr;
+    }
+    return fdopen(reportFd, "w");
+#endif
+}
+
+std::string PercentilesToJson(const Percentiles& p) {
+    return fmt::format(R"({{"p50": {:.4f}, "p95": {:.4f}, "p99": {:.4f}, "mean": {:.4f}, "max": {:.4f}}})", p.p50, p.p95, p.p99, p.mean, p.max);
+}
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!ParseArguments(argc, argv, options)) {
+        std::cerr << "usage: sirius-bench <scene.glb> [--frames N] [--warmup N] [--path camera_path.txt] [--width W] [--height H] [--out result.json] [--trace trace.json]" << std::endl;
+        return 1;
+    }
+
+    sirius::CameraPath path = DefaultCameraPath();
+    if (!options.cameraPath.empty()) {
+        auto loaded = sirius::CameraPath::LoadFromFile(options.cameraPath);
+        if (!loaded.has_value()) {
+            std::cerr << "Failed to load camera path " << options.cameraPath << std::endl;
+            return 1;
+        }
+        path = std::move(*loaded);
+    }
+
+    FILE* report = DivertStdoutToStderr();
+    if (report == nullptr) {
+        std::cerr << "Failed to redirect stdout" << std::endl;
+        return 1;
+    }
+
+    sirius::RendererConfig config{};
+    config.headless = true;
+    config.width = options.width;
+    config.height = options.height;
+    config.scenePath = options.scenePath;
+
+    sirius::SrsVkRenderer renderer;
+    renderer.Init(config);
+
+    std::vector<sirius::FrameStats> stats;
+    stats.reserve(options.frames);
+    renderer.SetFrameStatsCallback([&](const sirius::FrameStats& frame) {
+        if (frame.frameNumber >= options.warmup) {
+            stats.push_back(frame);
+        }
+    });
+
+    // Frames are spread evenly over the path, independent of how long they take to render
+    const int totalFrames = options.warmup + options.frames;
+    const float duration = path.GetDuration();
+    std::vector<double> wallFrameMs;
+    wallFrameMs.reserve(options.frames);
+
+    for (int i = 0; i < totalFrames; i++) {
+        const float t = options.frames > 1 ? static_cast<float>(std::max(i - options.warmup, 0)) / static_cast<float>(options.frames - 1) : 0.0f;
+        path.Apply(renderer.GetCamera(), t * duration);
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        renderer.Draw();
+        const auto end = std::chrono::high_resolution_clock::now();
+
+        if (i >= options.warmup) {
+            wallFrameMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+    }
+
+    if (!options.tracePath.empty()) {
+#ifdef SIRIUS_PROFILING
+        sirius::Profiler::WriteChromeTrace(options.tracePath);
+#else
+        std::cerr << "Built without SIRIUS_PROFILING, no trace is written" << std::endl;
+#endif
+    }
+
+    // Shutdown hands out the stats of the frames that are still in flight
+    renderer.Shutdown();
+
+    std::vector<double> cpuMs;
+    std::vector<double> gpuMs;
+    std::vector<double> draws;
+    std::vector<double> triangles;
+    std::vector<double> binds;
+    std::map<std::string, std::vector<double>> passMs;
+    for (const auto& frame : stats) {
+        for (const auto& [name, milliseconds] : frame.gpuPasses) {
+            passMs[name].push_back(milliseconds);
+        }
+        cpuMs.push_back(frame.cpuFrameMs);
+        gpuMs.push_back(frame.gpuFrameMs);
+        draws.push_back(frame.drawCount);
+        triangles.push_back(static_cast<double>(frame.triangleCount));
+        binds.push_back(frame.pipelineBinds + frame.descriptorSetBinds + frame.indexBufferBinds);
+    }
+
+    std::string json = "{\n";
+    json += fmt::format("  \"scene\": \"{}\",\n", sirius::Utils::EscapeJson(options.scenePath));
+    json += fmt::format("  \"frames\": {},\n", stats.size());
+    json += fmt::format("  \"resolution\": [{}, {}],\n", options.width, options.height);
+    json += fmt::format("  \"cpu_ms\": {},\n", PercentilesToJson(ComputePercentiles(cpuMs)));
+    json += fmt::format("  \"gpu_ms\": {},\n", PercentilesToJson(ComputePercentiles(gpuMs)));
+    json += fmt::format("  \"frame_ms\": {},\n", PercentilesToJson(ComputePercentiles(wallFrameMs)));
+    json += fmt::format("  \"draws\": {},\n", PercentilesToJson(ComputePercentiles(draws)));
+    json += fmt::format("  \"triangles\": {},\n", PercentilesToJson(ComputePercentiles(triangles)));
+    json += fmt::format("  \"binds\": {},\n", PercentilesToJson(ComputePercentiles(binds)));
+    json += "  \"gpu_passes\": {";
+    for (auto it = passMs.begin(); it != passMs.end(); ++it) {
+        json += fmt::format("{}\n    \"{}\": {}", it == passMs.begin() ? "" : ",", sirius::Utils::EscapeJson(it->first), PercentilesToJson(ComputePercentiles(it->second)));
+    }
+    json += "\n  }\n";
+    json += "}\n";
+
+    if (options.outPath.empty()) {
+        std::fputs(json.c_str(), report);
+    } else {
+        auto out = fmt::output_file(options.outPath);
+        out.print("{}", json);
+    }
+    std::fclose(report);
+    return 0;
+}
@@ -0,0 +1,116 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+// Measures the overhead and scaling of the job system, needs no GPU.
+// usage: sirius-jobs-bench [--workers N] [--jobs N]
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "core/jobs.h"
+
+namespace {
+using Clock = std::chrono::high_resolution_clock;
+
+double MillisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Enough arithmetic per element that the loop is compute bound
+float Work(float value) {
+    for (int i = 0; i < 32; i++) {
+        value = std::sqrt(value * value + 1.0f);
+    }
+    return value;
+}
+
+void BenchEmptyJobs(uint32_t jobCount) {
+    sirius::JobCounter counter;
+    const auto start = Clock::now();
+    for (uint32_t i = 0; i < jobCount; i++) {
+        sirius::JobSystem::Run([] {}, &counter);
+    }
+    sirius::JobSystem::Wait(counter);
+    const double milliseconds = MillisecondsSince(start);
+
+    fmt::println("empty jobs:      {} jobs in {:.2f} ms, {:.0f} ns per job", jobCount, milliseconds, milliseconds * 1e6 / jobCount);
+}
+
+void BenchDependencyChain(uint32_t length) {
+    std::vector<sirius::JobCounter> counters(length);
+    const auto start = Clock::now();
+    sirius::JobSystem::Run([] {}, &counters[0]);
+    for (uint32_t i = 1; i < length; i++) {
+        sirius::JobSystem::RunAfter(counters[i - 1], [] {}, &counters[i]);
+    }
+    sirius::JobSystem::Wait(counters.back());
+    const double milliseconds = MillisecondsSince(start);
+
+    fmt::println("dependency chain: {} jobs in {:.2f} ms, {:.0f} ns per link", length, milliseconds, milliseconds * 1e6 / length);
+}
+
+void BenchParallelFor(uint32_t elementCount) {
+    std::vector<float> values(elementCount);
+    std::iota(values.begin(), values.end(), 0.0f);
+
+    auto start = Clock::now();
+    for (float& value : values) {
+        value = Work(value);
+    }
+    const double serial = MillisecondsSince(start);
+
+    std::iota(values.begin(), values.end(), 0.0f);
+    start = Clock::now();
+    sirius::JobSystem::ParallelFor(std::span(values), 4096, [](float& value) { value = Work(value); });
+    const double parallel = MillisecondsSince(start);
+
+    fmt::println("parallel for:    {} elements, serial {:.2f} ms, parallel {:.2f} ms, speedup {:.2f}x on {} threads", elementCount, serial, parallel,
+                 serial / parallel, sirius::JobSystem::GetWorkerCount() + 1);
+}
+
+void BenchMainThreadJobs(uint32_t jobCount) {
+    sirius::JobCounter counter;
+    uint32_t ranOnMain = 0;
+    const auto start = Clock::now();
+    for (uint32_t i = 0; i < jobCount; i++) {
+        sirius::JobSystem::Run([&] { ranOnMain += sirius::JobSystem::IsMainThread() ? 1 : 0; }, &counter, sirius::JobAffinity::MainThread);
+    }
+    sirius::JobSystem::Wait(counter);
+    const double milliseconds = MillisecondsSince(start);
+
+    fmt::println("main thread:     {} of {} jobs on the main thread in {:.2f} ms", ranOnMain, jobCount, milliseconds);
+}
+}
+
+int main(int argc, char** argv) {
+    uint32_t workers = 0;
+    uint32_t jobs = 1 << 20;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--workers") == 0) {
+            workers = std::stoul(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--jobs") == 0) {
+            jobs = std::stoul(argv[i + 1]);
+        } else {
+            fmt::println("usage: sirius-jobs-bench [--workers N] [--jobs N]");
+            return 1;
+        }
+    }
+
+    sirius::JobSystem::Init(workers);
+    fmt::println("{} workers", sirius::JobSystem::GetWorkerCount());
+
+    BenchEmptyJobs(jobs);
+    BenchDependencyChain(jobs / 16);
+    BenchParallelFor(jobs * 4);
+    BenchMainThreadJobs(jobs / 16);
+
+    sirius::JobSystem::Shutdown();
+    return 0;
+}
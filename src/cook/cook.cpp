@@ -0,0 +1,193 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+// Converts a glTF file into a scene package that the renderer maps and uploads without parsing, needs no GPU.
+// usage: sirius-cook <scene.glb> [--out scene.srspkg] [--workers N] [--full-vertices]
+// Vertices are stored as CompactVertex where the mesh allows it, --full-vertices keeps every mesh at full precision
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "core/jobs.h"
+#include "graphics/gltf_decode.h"
+#include "graphics/texture_transcoder.h"
+#include "fastgltf/core.hpp"
+
+namespace {
+using Clock = std::chrono::high_resolution_clock;
+
+double MillisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// KTX2 files stay as they are, the target format depends on the device. Everything else is decoded to RGBA8
+void CookImages(const fastgltf::Asset& gltf, const std::filesystem::path& directory, sirius::ScenePackageWriter& package) {
+    struct CookedImage {
+        sirius::EncodedImage encoded;
+        sirius::Rgba8Image decoded;
+        bool ktx2;
+    };
+
+    std::vector<CookedImage> cooked(gltf.images.size());
+    sirius::JobSystem::ParallelFor(static_cast<uint32_t>(gltf.images.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            CookedImage& image = cooked[i];
+            image.encoded = sirius::ReadImage(gltf, gltf.images[i], directory);
+            image.ktx2 = sirius::TextureTranscoder::IsKtx2(image.encoded.bytes);
+            if (!image.ktx2) {
+                image.decoded = sirius::DecodeRgba8(image.encoded.bytes);
+            }
+        }
+    });
+
+    for (size_t i = 0; i < cooked.size(); i++) {
+        const CookedImage& image = cooked[i];
+
+        sirius::PackageImage packageImage{};
+        packageImage.name = package.AddString(gltf.images[i].name.c_str());
+        if (image.ktx2) {
+            packageImage.kind = sirius::PackageImageKind::kKtx2;
+            packageImage.offset = package.AddImageData(image.encoded.bytes);
+            packageImage.size = image.encoded.bytes.size();
+        } else {
+            // An undecodable image is stored empty, the loader shows the error texture for it
+            packageImage.kind = sirius::PackageImageKind::kRgba8;
+            if (image.decoded.pixels != nullptr) {
+                packageImage.width = image.decoded.extent.width;
+                packageImage.height = image.decoded.extent.height;
+                packageImage.size = static_cast<uint64_t>(packageImage.width) * packageImage.height * 4;
+                packageImage.offset = package.AddImageData(std::span(reinterpret_cast<const std::byte*>(image.decoded.pixels.get()), packageImage.size));
+            } else {
+                fmt::println("warning: cannot decode image {} ({})", i, gltf.images[i].name.c_str());
+            }
+        }
+        package.images_.push_back(packageImage);
+    }
+}
+
+void CookMeshes(const fastgltf::Asset& gltf, bool compactVertices, sirius::ScenePackageWriter& package) {
+    std::vector<sirius::DecodedMesh> decodedMeshes = sirius::DecodeMeshes(gltf, compactVertices);
+
+    const sirius::MeshOptimizationStats optimization = sirius::GetOptimizationStats(decodedMeshes);
+    fmt::println("optimized meshes: {} -> {} vertices, ACMR {:.3f} -> {:.3f}, {} -> {} triangles at the coarsest LOD", optimization.verticesBefore,
+                 optimization.verticesAfter, optimization.GetAcmrBefore(), optimization.GetAcmrAfter(), optimization.triangleCount, optimization.coarsestLodTriangles);
+
+    for (size_t i = 0; i < decodedMeshes.size(); i++) {
+        const sirius::DecodedMesh& decoded = decodedMeshes[i];
+        const sirius::PackedVertices& vertices = decoded.packedVertices;
+        const sirius::PackedIndices& indices = decoded.packedIndices;
+
+        sirius::PackageMesh mesh{};
+        mesh.name = package.AddString(gltf.meshes[i].name.c_str());
+        mesh.firstSurface = static_cast<uint32_t>(package.surfaces_.size());
+        mesh.surfaceCount = static_cast<uint32_t>(decoded.surfaces.size());
+        mesh.firstMeshlet = static_cast<uint32_t>(package.meshlets_.size());
+        mesh.meshletCount = static_cast<uint32_t>(decoded.meshlets.size());
+        mesh.vertexFormat = vertices.format;
+        mesh.quantization = vertices.quantization;
+        mesh.vertexOffset = package.vertices_.size();
+        mesh.vertexSize = vertices.bytes.size();
+        mesh.indexType = indices.type;
+        mesh.indexOffset = package.indices_.size();
+        mesh.indexSize = indices.bytes.size();
+        mesh.bounds = decoded.bounds;
+
+        package.surfaces_.insert(package.surfaces_.end(), decoded.surfaces.begin(), decoded.surfaces.end());
+        package.vertices_.insert(package.vertices_.end(), vertices.bytes.begin(), vertices.bytes.end());
+        package.indices_.insert(package.indices_.end(), indices.bytes.begin(), indices.bytes.end());
+        package.meshlets_.insert(package.meshlets_.end(), decoded.meshlets.begin(), decoded.meshlets.end());
+        package.meshes_.push_back(mesh);
+    }
+}
+}
+
+int main(int argc, char** argv) {
+    std::filesystem::path inputPath;
+    std::filesystem::path outputPath;
+    uint32_t workers = 0;
+    bool compactVertices = true;
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--out") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--workers") == 0 && hasValue) {
+            workers = std::stoul(argv[++i]);
+        } else if (std::strcmp(argv[i], "--full-vertices") == 0) {
+            compactVertices = false;
+        } else if (argv[i][0] != '-' && inputPath.empty()) {
+            inputPath = argv[i];
+        } else {
+            inputPath.clear();
+            break;
+        }
+    }
+    if (inputPath.empty()) {
+        fmt::println("usage: sirius-cook <scene.glb> [--out scene.srspkg] [--workers N] [--full-vertices]");
+        return 1;
+    }
+    if (outputPath.empty()) {
+        outputPath = inputPath;
+        outputPath.replace_extension(sirius::kScenePackageExtension);
+    }
+
+    sirius::JobSystem::Init(workers);
+    const auto start = Clock::now();
+
+    std::optional<fastgltf::Asset> gltf = sirius::ParseGltf(inputPath);
+    if (!gltf) {
+        sirius::JobSystem::Shutdown();
+        return 1;
+    }
+    const double parseMs = MillisecondsSince(start);
+
+    sirius::ScenePackageWriter package;
+    package.samplers_ = sirius::ConvertSamplers(*gltf);
+
+    auto stageStart = Clock::now();
+    CookImages(*gltf, inputPath.parent_path(), package);
+    const double imageMs = MillisecondsSince(stageStart);
+
+    for (const fastgltf::Material& material : gltf->materials) {
+        sirius::PackageMaterial packageMaterial = sirius::ConvertMaterial(*gltf, material);
+        packageMaterial.name = package.AddString(material.name.c_str());
+        package.materials_.push_back(packageMaterial);
+    }
+
+    stageStart = Clock::now();
+    CookMeshes(*gltf, compactVertices, package);
+    const double meshMs = MillisecondsSince(stageStart);
+
+    std::vector<uint32_t> gltfIndices;
+    package.nodes_ = sirius::ConvertNodes(*gltf, gltfIndices);
+    for (size_t i = 0; i < gltfIndices.size(); i++) {
+        // GPU instances have no name of their own
+        if (gltfIndices[i] != sirius::kPackageNone) {
+            package.nodes_[i].name = package.AddString(gltf->nodes[gltfIndices[i]].name.c_str());
+        }
+    }
+
+    sirius::JobSystem::Shutdown();
+
+    if (!package.Write(outputPath)) {
+        fmt::println("error: cannot write {}", outputPath.string());
+        return 1;
+    }
+
+    uint64_t vertexCount = 0;
+    uint64_t indexCount = 0;
+    for (const sirius::PackageMesh& mesh : package.meshes_) {
+        vertexCount += mesh.vertexSize / sirius::GetVertexStride(mesh.vertexFormat);
+        indexCount += mesh.indexSize / sirius::GetIndexSize(mesh.indexType);
+    }
+
+    fmt::println("{} -> {}: {} meshes, {} vertices, {} indices, {} meshlets, {} images, {} nodes, {:.1f} MB", inputPath.string(), outputPath.string(),
+                 package.meshes_.size(), vertexCount, indexCount, package.meshlets_.size(), package.images_.size(), package.nodes_.size(),
+                 static_cast<double>(std::filesystem::file_size(outputPath)) / (1024.0 * 1024.0));
+    fmt::println("parse {:.1f} ms, images {:.1f} ms, meshes {:.1f} ms, total {:.1f} ms", parseMs, imageMs, meshMs, MillisecondsSince(start));
+    return 0;
+}
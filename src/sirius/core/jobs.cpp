@@ -0,0 +1,305 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "jobs.h"
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <thread>
+
+#include "profiler.h"
+
+namespace sirius {
+namespace {
+constexpr uint32_t kMainThreadIndex = 0;
+constexpr uint32_t kNoThreadIndex = UINT32_MAX;
+
+struct WorkQueue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+};
+
+struct Scheduler {
+    // Index 0 is the main thread, workers follow
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    WorkQueue mainThreadJobs;
+    std::vector<std::thread> workers;
+
+    // Jobs in the stealable queues, incremented under the sleep mutex so a sleeping worker cannot miss one
+    std::atomic<int64_t> queuedJobs{0};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<bool> stopping{false};
+
+    // Jobs started with Run or RunAfter that have not finished, Shutdown waits for them
+    std::atomic<int64_t> unfinishedJobs{0};
+
+    // Threads outside the system hand their jobs out round-robin
+    std::atomic<uint32_t> nextQueue{0};
+};
+
+Scheduler& GetScheduler() {
+    static Scheduler scheduler;
+    return scheduler;
+}
+
+thread_local uint32_t tlsThreadIndex = kNoThreadIndex;
+
+std::optional<Job> PopBack(WorkQueue& queue) {
+    std::lock_guard lock(queue.mutex);
+    if (queue.jobs.empty()) {
+        return std::nullopt;
+    }
+    Job job = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+    return job;
+}
+
+std::optional<Job> PopFront(WorkQueue& queue) {
+    std::lock_guard lock(queue.mutex);
+    if (queue.jobs.empty()) {
+        return std::nullopt;
+    }
+    Job job = std::move(queue.jobs.front());
+    queue.jobs.pop_front();
+    return job;
+}
+}
+
+void JobSystem::Init(uint32_t workerCount) {
+    Scheduler& scheduler = GetScheduler();
+    if (workerCount == 0) {
+        workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+    tlsThreadIndex = kMainThreadIndex;
+    scheduler.stopping = false;
+    for (uint32_t i = 0; i <= workerCount; i++) {
+        scheduler.queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (uint32_t i = 1; i <= workerCount; i++) {
+        scheduler.workers.emplace_back(&JobSystem::WorkerLoop, i);
+    }
+}
+
+void JobSystem::Shutdown() {
+    Scheduler& scheduler = GetScheduler();
+    assert(scheduler.queues.empty() || IsMainThread());
+
+    // Nothing is dropped: the main thread helps until every job ran, dependents are counted from RunAfter on so they are included
+    while (!scheduler.queues.empty() && scheduler.unfinishedJobs.load(std::memory_order_acquire) > 0) {
+        if (!TryRunJob(kMainThreadIndex)) {
+            std::this_thread::yield();
+        }
+    }
+
+    {
+        std::lock_guard lock(scheduler.sleepMutex);
+        scheduler.stopping = true;
+    }
+    scheduler.wake.notify_all();
+
+    for (std::thread& worker : scheduler.workers) {
+        worker.join();
+    }
+    scheduler.workers.clear();
+    scheduler.queues.clear();
+    assert(scheduler.mainThreadJobs.jobs.empty() && scheduler.queuedJobs == 0);
+}
+
+void JobSystem::Run(std::function<void()> function, JobCounter* counter, JobAffinity affinity) {
+    GetScheduler().unfinishedJobs.fetch_add(1, std::memory_order_relaxed);
+    if (counter != nullptr) {
+        counter->value_.fetch_add(1, std::memory_order_relaxed);
+    }
+    Schedule({std::move(function), counter, affinity});
+}
+
+void JobSystem::RunAfter(JobCounter& dependency, std::function<void()> function, JobCounter* counter, JobAffinity affinity) {
+    GetScheduler().unfinishedJobs.fetch_add(1, std::memory_order_relaxed);
+    if (counter != nullptr) {
+        counter->value_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Job job{std::move(function), counter, affinity};
+    {
+        // The last job of the dependency takes the same lock before it releases the dependents
+        std::lock_guard lock(dependency.mutex_);
+        if (dependency.value_.load(std::memory_order_acquire) != 0) {
+            dependency.dependents_.push_back(std::move(job));
+            return;
+        }
+    }
+    Schedule(std::move(job));
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+    SRS_PROFILE_SCOPE("JobSystem::Wait");
+    const uint32_t threadIndex = tlsThreadIndex;
+
+    while (!counter.IsDone()) {
+        if (threadIndex == kNoThreadIndex || !TryRunJob(threadIndex)) {
+            std::this_thread::yield();
+        }
+    }
+
+    // The last job may still hold the lock, after this the counter can be destroyed
+    std::lock_guard lock(counter.mutex_);
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& function) {
+    if (count == 0) {
+        return;
+    }
+
+    grainSize = std::max(grainSize, 1u);
+    JobCounter counter;
+
+    // The calling thread takes the first range itself instead of idling in Wait
+    for (uint32_t begin = grainSize; begin < count; begin += grainSize) {
+        const uint32_t end = std::min(begin + grainSize, count);
+        Run([&function, begin, end] { function(begin, end); }, &counter);
+    }
+    function(0, std::min(grainSize, count));
+
+    Wait(counter);
+}
+
+void JobSystem::RunMainThreadJobs() {
+    SRS_PROFILE_SCOPE("JobSystem::RunMainThreadJobs");
+    Scheduler& scheduler = GetScheduler();
+
+    // Jobs queued by the jobs run here wait for the next call
+    std::deque<Job> jobs;
+    {
+        std::lock_guard lock(scheduler.mainThreadJobs.mutex);
+        jobs.swap(scheduler.mainThreadJobs.jobs);
+    }
+    for (Job& job : jobs) {
+        Execute(job);
+    }
+}
+
+uint32_t JobSystem::GetWorkerCount() {
+    return static_cast<uint32_t>(GetScheduler().workers.size());
+}
+
+bool JobSystem::IsMainThread() {
+    return tlsThreadIndex == kMainThreadIndex;
+}
+
+uint32_t JobSystem::GetThreadIndex() {
+    return tlsThreadIndex;
+}
+
+void JobSystem::Schedule(Job&& job) {
+    Scheduler& scheduler = GetScheduler();
+
+    // Before Init and after Shutdown there are no queues, the job runs right away on the calling thread
+    if (scheduler.queues.empty()) {
+        Execute(job);
+        return;
+    }
+
+    if (job.affinity == JobAffinity::MainThread) {
+        std::lock_guard lock(scheduler.mainThreadJobs.mutex);
+        scheduler.mainThreadJobs.jobs.push_back(std::move(job));
+        return;
+    }
+
+    uint32_t queueIndex = tlsThreadIndex;
+    if (queueIndex == kNoThreadIndex) {
+        queueIndex = scheduler.nextQueue.fetch_add(1, std::memory_order_relaxed) % scheduler.queues.size();
+    }
+
+    {
+        WorkQueue& queue = *scheduler.queues[queueIndex];
+        std::lock_guard lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+    {
+        std::lock_guard lock(scheduler.sleepMutex);
+        scheduler.queuedJobs.fetch_add(1, std::memory_order_relaxed);
+    }
+    scheduler.wake.notify_one();
+}
+
+void JobSystem::Execute(Job& job) {
+    job.function();
+    // The dependents this releases were counted when they were created, so the count cannot hit zero too early
+    GetScheduler().unfinishedJobs.fetch_sub(1, std::memory_order_release);
+
+    JobCounter* counter = job.counter;
+    if (counter == nullptr) {
+        return;
+    }
+
+    // Only the decrement that may reach zero takes the lock, it has to be atomic with releasing the dependents
+    uint32_t value = counter->value_.load(std::memory_order_relaxed);
+    while (value > 1 && !counter->value_.compare_exchange_weak(value, value - 1, std::memory_order_acq_rel)) {
+    }
+    if (value > 1) {
+        return;
+    }
+
+    std::vector<Job> dependents;
+    {
+        std::lock_guard lock(counter->mutex_);
+        if (counter->value_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            dependents.swap(counter->dependents_);
+        }
+    }
+    for (Job& dependent : dependents) {
+        Schedule(std::move(dependent));
+    }
+}
+
+bool JobSystem::TryRunJob(uint32_t threadIndex) {
+    Scheduler& scheduler = GetScheduler();
+
+    if (threadIndex == kMainThreadIndex) {
+        if (std::optional<Job> job = PopFront(scheduler.mainThreadJobs)) {
+            Execute(*job);
+            return true;
+        }
+    }
+
+    // Newest own job first, it is likely still in cache. Steal the oldest jobs of the others, they tend to be the biggest
+    std::optional<Job> job = PopBack(*scheduler.queues[threadIndex]);
+    const auto queueCount = static_cast<uint32_t>(scheduler.queues.size());
+    for (uint32_t i = 1; !job && i < queueCount; i++) {
+        job = PopFront(*scheduler.queues[(threadIndex + i) % queueCount]);
+    }
+
+    if (!job) {
+        return false;
+    }
+
+    scheduler.queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    Execute(*job);
+    return true;
+}
+
+void JobSystem::WorkerLoop(uint32_t threadIndex) {
+    SRS_PROFILE_THREAD("Job worker");
+    tlsThreadIndex = threadIndex;
+    Scheduler& scheduler = GetScheduler();
+
+    while (true) {
+        if (TryRunJob(threadIndex)) {
+            continue;
+        }
+
+        std::unique_lock lock(scheduler.sleepMutex);
+        scheduler.wake.wait(lock, [&] { return scheduler.stopping || scheduler.queuedJobs.load(std::memory_order_relaxed) > 0; });
+        if (scheduler.stopping) {
+            return;
+        }
+    }
+}
+}
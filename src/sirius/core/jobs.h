@@ -0,0 +1,100 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace sirius {
+class JobCounter;
+
+enum class JobAffinity {
+    Any,
+    // Only run by the thread that called JobSystem::Init, from Wait or RunMainThreadJobs
+    MainThread,
+};
+
+struct Job {
+    std::function<void()> function;
+    JobCounter* counter = nullptr;
+    JobAffinity affinity = JobAffinity::Any;
+};
+
+// Counts the unfinished jobs that were started with it. Jobs can depend on a counter, they start once it reaches zero.
+// A counter must outlive the jobs that use it, Wait on it before destroying it
+class JobCounter {
+public:
+    JobCounter() = default;
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    [[nodiscard]] bool IsDone() const { return value_.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> value_{0};
+    std::mutex mutex_;
+    // Jobs waiting for the counter to reach zero
+    std::vector<Job> dependents_;
+};
+
+// Work-stealing scheduler. Every worker owns a deque: it pushes and pops jobs at the back, idle workers steal from the front of the others.
+// The main thread owns a deque too and runs jobs while it waits
+class JobSystem {
+public:
+    // Call from the main thread. Zero workers picks one per hardware thread besides the main thread
+    static void Init(uint32_t workerCount = 0);
+
+    // Call from the main thread. Runs every job that is still queued, including main thread jobs and jobs waiting in RunAfter, then stops the workers
+    static void Shutdown();
+
+    // Before Init or after Shutdown the job runs right away on the calling thread
+    static void Run(std::function<void()> function, JobCounter* counter = nullptr, JobAffinity affinity = JobAffinity::Any);
+
+    // Queues the job once dependency reaches zero. counter is incremented right away
+    static void RunAfter(JobCounter& dependency, std::function<void()> function, JobCounter* counter = nullptr, JobAffinity affinity = JobAffinity::Any);
+
+    // Runs other jobs until the counter reaches zero. The main thread also runs main thread jobs
+    static void Wait(JobCounter& counter);
+
+    // Splits [0, count) into ranges of about grainSize elements and calls function(begin, end) on each in parallel. Returns when all are done
+    static void ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& function);
+
+    template<typename T, typename Function>
+    static void ParallelFor(std::span<T> items, uint32_t grainSize, Function&& function) {
+        ParallelFor(static_cast<uint32_t>(items.size()), grainSize, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                function(items[i]);
+            }
+        });
+    }
+
+    // Runs the queued main thread jobs, call once per frame
+    static void RunMainThreadJobs();
+
+    [[nodiscard]] static uint32_t GetWorkerCount();
+
+    [[nodiscard]] static bool IsMainThread();
+
+    // 0 for the main thread, 1 to GetWorkerCount() for the workers, UINT32_MAX for threads outside the system.
+    // Lets jobs pick per-thread state without locking it
+    [[nodiscard]] static uint32_t GetThreadIndex();
+
+private:
+    static void Schedule(Job&& job);
+
+    static void Execute(Job& job);
+
+    static bool TryRunJob(uint32_t threadIndex);
+
+    static void WorkerLoop(uint32_t threadIndex);
+};
+}
@@ -0,0 +1,37 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace sirius {
+// Read-only view of a whole file through the page cache, nothing is read until it is touched
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false if the file cannot be opened or is empty
+    bool Open(const std::filesystem::path& path);
+
+    void Close();
+
+    [[nodiscard]] std::span<const std::byte> GetData() const { return {data_, size_}; }
+
+private:
+    const std::byte* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
+}
@@ -0,0 +1,123 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <fmt/os.h>
+
+#include "utils.h"
+
+namespace sirius {
+namespace {
+struct ZoneEvent {
+    const char* name;
+    uint64_t startNs;
+    uint64_t endNs;
+};
+
+// Only the owning thread writes the events, the head and the name. The head is published so a dump sees completed events.
+// Clear moves the tail up to the head instead of resetting the head under the owning thread
+struct ThreadBuffer {
+    uint32_t threadId;
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+    std::array<ZoneEvent, Profiler::kEventsPerThread> events;
+};
+
+struct Registry {
+    std::mutex mutex;
+    // Buffers are shared so the zones of threads that already exited still end up in the trace
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+};
+
+Registry& GetRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+ThreadBuffer& GetThreadBuffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+        auto newBuffer = std::make_shared<ThreadBuffer>();
+        Registry& registry = GetRegistry();
+        std::lock_guard lock(registry.mutex);
+        newBuffer->threadId = static_cast<uint32_t>(registry.buffers.size());
+        registry.buffers.push_back(newBuffer);
+        return newBuffer;
+    }();
+    return *buffer;
+}
+}
+
+void Profiler::SetThreadName(const char* name) {
+    GetThreadBuffer().name.store(name, std::memory_order_release);
+}
+
+void Profiler::RecordZone(const char* name, uint64_t startNs, uint64_t endNs) {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head % kEventsPerThread] = {name, startNs, endNs};
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+uint64_t Profiler::Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - GetRegistry().start).count();
+}
+
+bool Profiler::WriteChromeTrace(const std::filesystem::path& path) {
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard lock(registry.mutex);
+        buffers = registry.buffers;
+    }
+
+    try {
+        auto out = fmt::output_file(path.string());
+        out.print("{{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+        bool first = true;
+        for (const auto& buffer : buffers) {
+            if (const char* name = buffer->name.load(std::memory_order_acquire); name != nullptr) {
+                out.print("{}{{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": {}, \"args\": {{\"name\": \"{}\"}}}}", first ? "" : ",\n", buffer->threadId,
+                          Utils::EscapeJson(name));
+                first = false;
+            }
+
+            const uint64_t head = buffer->head.load(std::memory_order_acquire);
+            const uint64_t begin = std::max(buffer->tail.load(std::memory_order_relaxed), head - std::min<uint64_t>(head, kEventsPerThread));
+            for (uint64_t i = begin; i < head; i++) {
+                const ZoneEvent& event = buffer->events[i % kEventsPerThread];
+                // Trace timestamps are in microseconds
+                out.print("{}{{\"name\": \"{}\", \"ph\": \"X\", \"pid\": 0, \"tid\": {}, \"ts\": {:.3f}, \"dur\": {:.3f}}}", first ? "" : ",\n", Utils::EscapeJson(event.name), buffer->threadId,
+                          static_cast<double>(event.startNs) / 1000.0, static_cast<double>(event.endNs - event.startNs) / 1000.0);
+                first = false;
+            }
+        }
+
+        out.print("\n]}}\n");
+    } catch (const std::system_error& e) {
+        fmt::println("Failed to write trace {}: {}", path.string(), e.what());
+        return false;
+    }
+    return true;
+}
+
+void Profiler::Clear() {
+    Registry& registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    for (const auto& buffer : registry.buffers) {
+        buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
+}
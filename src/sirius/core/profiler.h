@@ -0,0 +1,57 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+namespace sirius {
+// Collects CPU zones into per-thread ring buffers, the oldest zones get overwritten once a buffer is full.
+// Only use through the SRS_PROFILE macros so the instrumentation disappears when SIRIUS_PROFILING is off
+class Profiler {
+public:
+    static constexpr size_t kEventsPerThread = 1 << 16;
+
+    // Names have to outlive the profiler, string literals are expected
+    static void SetThreadName(const char* name);
+
+    static void RecordZone(const char* name, uint64_t startNs, uint64_t endNs);
+
+    // Nanoseconds since the profiler was first used
+    static uint64_t Now();
+
+    // Writes every recorded zone in the Chrome trace event format, readable by chrome://tracing and Perfetto.
+    // Zones recorded by other threads while writing may be torn, dump between frames
+    static bool WriteChromeTrace(const std::filesystem::path& path);
+
+    // Drops every zone recorded so far, safe while other threads keep recording
+    static void Clear();
+};
+
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name) : name_(name), start_(Profiler::Now()) {}
+
+    ~ProfileZone() { Profiler::RecordZone(name_, start_, Profiler::Now()); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name_;
+    uint64_t start_;
+};
+}
+
+#define SRS_PROFILE_CONCAT_INNER(a, b) a##b
+#define SRS_PROFILE_CONCAT(a, b) SRS_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef SIRIUS_PROFILING
+#define SRS_PROFILE_SCOPE(name) ::sirius::ProfileZone SRS_PROFILE_CONCAT(srsProfileZone, __LINE__){name}
+#define SRS_PROFILE_THREAD(name) ::sirius::Profiler::SetThreadName(name)
+#else
+#define SRS_PROFILE_SCOPE(name)
+#define SRS_PROFILE_THREAD(name)
+#endif
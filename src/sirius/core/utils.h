@@ -3,6 +3,13 @@
 //
 
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <initializer_list>
+#include <span>
+#include <string>
+#include <string_view>
 #include <vulkan/vulkan.h>
 
 namespace sirius {
@@ -18,5 +25,19 @@ public:
     static void TransitionImage(VkCommandBuffer cmd, VkImage image, VkImageLayout currentLayout, VkImageLayout newLayout, const TransitionFlags& flags);
 
     static void CopyImageToImage(VkCommandBuffer cmd, VkImage source, VkImage destination, VkExtent2D srcExtend, VkExtent2D dstExtend);
+
+    // Fills every mip level by blitting down from level 0. All levels have to be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+    // they end up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    static void GenerateMipmaps(VkCommandBuffer cmd, VkImage image, VkExtent2D imageSize);
+
+    // Contents of a JSON string literal, without the quotes. Paths and names may contain backslashes and quotes
+    static std::string EscapeJson(std::string_view text);
+
+    // FNV-1a, names the cache files and checks their contents
+    static uint64_t HashBytes(std::span<const std::byte> data);
+
+    // Writes the parts one after the other under a name of its own and renames the file over the path, a reader never sees half a file and a
+    // crash while writing leaves the previous one intact. False if nothing was written
+    static bool WriteFileAtomically(const std::filesystem::path& path, std::initializer_list<std::span<const std::byte>> parts);
 };
 }
@@ -4,237 +4,179 @@
 
 #include "asset_loader.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
-#include <ext/matrix_transform.hpp>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <gtx/quaternion.hpp>
+#include <ranges>
+#include <span>
+#include <glm/glm.hpp>
 
 #include "vkRenderer.h"
+#include "vertex_compression.h"
+#include "core/jobs.h"
+#include "core/profiler.h"
 #include "fastgltf/core.hpp"
-#include "fastgltf/tools.hpp"
-#include "fastgltf/glm_element_traits.hpp"
 #include "fmt/compile.h"
 
 namespace sirius {
-void LoadedGltf::Draw(const glm::mat4& topMatrix, DrawContext& ctx) {
-    for (auto& node : topNodes_) {
-        node->Draw(topMatrix, ctx);
+namespace {
+// An image ready for upload: RGBA8 pixels or a transcoded KTX2 texture, neither if it could not be decoded
+struct DecodedImage {
+    std::span<const std::byte> pixels;
+    VkExtent3D extent;
+    std::optional<TranscodedTexture> compressed;
+    // Owns the pixels unless they point into a mapped package
+    Rgba8Image storage;
+};
+
+DecodedImage DecodeImage(std::span<const std::byte> bytes, TextureTranscoder& transcoder) {
+    DecodedImage decoded{};
+    if (TextureTranscoder::IsKtx2(bytes)) {
+        decoded.compressed = transcoder.Transcode(bytes);
+        return decoded;
     }
-}
-
-void LoadedGltf::ClearAll() {
-}
-
-std::optional<std::vector<std::shared_ptr<MeshAsset>>> LoadGltfMeshes(sirius::SrsVkRenderer* engine, std::filesystem::path filePath) {
-    std::cout << "\n" << "Loading GLTF: " << filePath << "\n" << std::endl;
-
-    fastgltf::Expected<fastgltf::GltfDataBuffer> result = fastgltf::GltfDataBuffer::FromPath(filePath);
-    if (!result) {
-        throw std::runtime_error("Failed to load glTF: " + std::to_string(static_cast<int>(result.error())));
-    }
-    auto data = std::move(result.get());
 
-    constexpr auto gltfOptions = fastgltf::Options::LoadExternalBuffers;
-
-    fastgltf::Asset gltf;
-    fastgltf::Parser parser{};
-
-    auto load = parser.loadGltfBinary(data, filePath.parent_path(), gltfOptions);
-    if (load) {
-        gltf = std::move(load.get());
-    } else {
-        fmt::print("Failed to load glTF: {} \n", fastgltf::to_underlying(load.error()));
-        return {};
+    decoded.storage = DecodeRgba8(bytes);
+    if (decoded.storage.pixels != nullptr) {
+        decoded.extent = decoded.storage.extent;
+        decoded.pixels = std::span(reinterpret_cast<const std::byte*>(decoded.storage.pixels.get()), static_cast<size_t>(decoded.extent.width) * decoded.extent.height * 4);
     }
+    return decoded;
+}
 
-    std::vector<std::shared_ptr<MeshAsset>> meshes;
-
-    // use the same vectors for all meshes so that the memory doesn't reallocate as
-    // often
-    std::vector<uint32_t> indices;
-    std::vector<Vertex> vertices;
-    for (fastgltf::Mesh& mesh : gltf.meshes) {
-        MeshAsset newMesh;
-
-        newMesh.name = mesh.name;
-
-        // clear the mesh arrays each mesh, we don't want to merge them by error
-        indices.clear();
-        vertices.clear();
-
-        for (auto&& primitive : mesh.primitives) {
-            GeoSurface newSurface{};
-            newSurface.startIndex = static_cast<uint32_t>(indices.size());
-            newSurface.count = static_cast<uint32_t>(gltf.accessors[primitive.indicesAccessor.value()].count);
-
-            size_t initialVtx = vertices.size();
-
-            // load indexes
-            {
-                fastgltf::Accessor& indexAccessor = gltf.accessors[primitive.indicesAccessor.value()];
-                indices.reserve(indices.size() + indexAccessor.count);
-
-                fastgltf::iterateAccessor<std::uint32_t>(gltf, indexAccessor, [&](const std::uint32_t idx) {
-                    indices.push_back(idx + initialVtx);
-                });
-            }
-
-            // load vertex positions
-            {
-                fastgltf::Accessor& posAccessor = gltf.accessors[primitive.findAttribute("POSITION")->accessorIndex];
-                vertices.resize(vertices.size() + posAccessor.count);
-
-                fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, posAccessor, [&](const glm::vec3 v, const size_t index) {
-                    Vertex newVertex{};
-                    newVertex.position = v;
-                    newVertex.normal = {1, 0, 0};
-                    newVertex.color = glm::vec4{1.f};
-                    newVertex.uvX = 0;
-                    newVertex.uvY = 0;
-                    vertices[initialVtx + index] = newVertex;
-                });
-            }
-
-            // load vertex normals
-            if (auto normals = primitive.findAttribute("NORMAL"); normals != primitive.attributes.end()) {
-                fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, gltf.accessors[normals->accessorIndex], [&](const glm::vec3 v, const size_t index) {
-                    vertices[initialVtx + index].normal = v;
-                });
-            }
-
-            // load UVs
-            if (auto uv = primitive.findAttribute("TEXCOORD_0"); uv != primitive.attributes.end()) {
-                fastgltf::iterateAccessorWithIndex<glm::vec2>(gltf, gltf.accessors[uv->accessorIndex], [&](const glm::vec2 v, const size_t index) {
-                    vertices[initialVtx + index].uvX = v.x;
-                    vertices[initialVtx + index].uvY = v.y;
-                });
-            }
-
-            // load vertex colors
-            if (auto colors = primitive.findAttribute("COLOR_0"); colors != primitive.attributes.end()) {
-                fastgltf::iterateAccessorWithIndex<glm::vec4>(gltf, gltf.accessors[colors->accessorIndex], [&](const glm::vec4 v, const size_t index) {
-                    vertices[initialVtx + index].color = v;
-                });
-            }
-            newMesh.surfaces.push_back(newSurface);
+std::vector<DecodedImage> DecodeGltfImages(const fastgltf::Asset& gltf, const std::filesystem::path& directory, TextureTranscoder& transcoder) {
+    std::vector<DecodedImage> decoded(gltf.images.size());
+    JobSystem::ParallelFor(static_cast<uint32_t>(gltf.images.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            SRS_PROFILE_SCOPE("DecodeImage");
+            const EncodedImage encoded = ReadImage(gltf, gltf.images[i], directory);
+            decoded[i] = DecodeImage(encoded.bytes, transcoder);
         }
+    });
+    return decoded;
+}
 
-        // display the vertex normals
-        constexpr bool overrideColors = false;
-        if (overrideColors) {
-            for (Vertex& vtx : vertices) {
-                vtx.color = glm::vec4(vtx.normal, 1.f);
+// RGBA8 images are used straight from the mapping, only KTX2 images have work left
+std::vector<DecodedImage> DecodePackageImages(const ScenePackage& package, TextureTranscoder& transcoder) {
+    const std::span<const PackageImage> images = package.GetImages();
+    std::vector<DecodedImage> decoded(images.size());
+    JobSystem::ParallelFor(static_cast<uint32_t>(images.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            if (images[i].kind == PackageImageKind::kKtx2) {
+                decoded[i].compressed = transcoder.Transcode(package.GetImageData(images[i]));
+            } else {
+                decoded[i].pixels = package.GetImageData(images[i]);
+                decoded[i].extent = {images[i].width, images[i].height, 1};
             }
         }
-        newMesh.meshBuffers = engine->UploadMesh(indices, vertices);
+    });
+    return decoded;
+}
 
-        meshes.emplace_back(std::make_shared<MeshAsset>(std::move(newMesh)));
-    }
+// A full mip chain adds a third to the first level
+VkDeviceSize Rgba8MipChainBytes(VkExtent3D extent) {
+    return static_cast<VkDeviceSize>(extent.width) * extent.height * 4 * 4 / 3;
+}
 
-    return meshes;
+double MillisecondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
 }
 
-std::optional<std::shared_ptr<LoadedGltf>> LoadGltf(SrsVkRenderer* renderer, std::string_view filePath) {
-    fmt::print("Loading GLTF: {}", filePath);
+template<typename T>
+std::vector<std::string> GetNames(const ScenePackage& package, std::span<const T> items) {
+    std::vector<std::string> names;
+    names.reserve(items.size());
+    for (const T& item : items) {
+        names.emplace_back(package.GetString(item.name));
+    }
+    return names;
+}
 
-    std::shared_ptr<LoadedGltf> scene = std::make_shared<LoadedGltf>();
-    scene->creator_ = renderer;
-    LoadedGltf& file = *scene;
+// The steps below are shared by glTF files and scene packages, both are converted to the package structs first
+
+void CreateSamplers(VkDevice device, LoadedGltf& file, std::span<const PackageSampler> samplers) {
+    for (const PackageSampler& sampler : samplers) {
+        VkSamplerCreateInfo sampl = {.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO, .pNext = nullptr};
+        sampl.maxLod = VK_LOD_CLAMP_NONE;
+        sampl.minLod = 0;
 
-    fastgltf::Parser parser{};
+        sampl.magFilter = sampler.magFilter;
+        sampl.minFilter = sampler.minFilter;
+        sampl.mipmapMode = sampler.mipmapMode;
 
-    constexpr auto gltfOptions = fastgltf::Options::DontRequireValidAssetMember | fastgltf::Options::AllowDouble | fastgltf::Options::LoadGLBBuffers | fastgltf::Options::LoadExternalBuffers;
-    // fastgltf::Options::LoadExternalImages;
+        VkSampler newSampler;
+        vkCreateSampler(device, &sampl, nullptr, &newSampler);
 
-    fastgltf::Expected<fastgltf::GltfDataBuffer> result = fastgltf::GltfDataBuffer::FromPath(filePath);
-    if (!result) {
-        throw std::runtime_error("Failed to load glTF: " + std::to_string(static_cast<int>(result.error())));
+        file.samplers_.push_back(newSampler);
     }
-    auto data = std::move(result.get());
+}
 
-    fastgltf::Asset gltf;
+// Images that failed to decode get the error texture
+std::vector<AllocatedImage> CreateImages(SrsVkRenderer* renderer, LoadedGltf& file, UploadBatch& uploads, std::span<const DecodedImage> decodedImages, std::span<const std::string> names) {
+    std::vector<AllocatedImage> images;
 
-    std::filesystem::path path = filePath;
+    // GPU memory of the textures, and what they would take as RGBA8
+    VkDeviceSize textureBytes = 0;
+    VkDeviceSize rgba8TextureBytes = 0;
+    for (size_t i = 0; i < decodedImages.size(); i++) {
+        const DecodedImage& decoded = decodedImages[i];
+        std::string name = names[i];
+
+        if (decoded.pixels.empty() && !decoded.compressed) {
+            fmt::println("Failed to load texture {} ({}), using the error texture", i, name);
+            images.push_back(renderer->errorCheckerboardImage_);
+            continue;
+        }
 
-    auto type = fastgltf::determineGltfFileType(data);
-    if (type == fastgltf::GltfType::glTF) {
-        auto load = parser.loadGltfBinary(data, path.parent_path(), gltfOptions);
-        if (load) {
-            gltf = std::move(load.get());
+        AllocatedImage image;
+        if (decoded.compressed) {
+            image = renderer->CreateImage(uploads, *decoded.compressed, VK_IMAGE_USAGE_SAMPLED_BIT);
+            textureBytes += decoded.compressed->data.size();
         } else {
-            std::cerr << "Failed to load glTF: " << fastgltf::to_underlying(load.error()) << std::endl;
-            return {};
+            image = renderer->CreateImage(uploads, decoded.pixels.data(), decoded.extent, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT, true);
+            textureBytes += Rgba8MipChainBytes(image.imageExtent);
         }
-    } else if (type == fastgltf::GltfType::GLB) {
-        auto load = parser.loadGltfBinary(data, path.parent_path(), gltfOptions);
-        if (load) {
-            gltf = std::move(load.get());
-        } else {
-            std::cerr << "Failed to load glb: " << fastgltf::to_underlying(load.error()) << std::endl;
-            return {};
+        rgba8TextureBytes += Rgba8MipChainBytes(image.imageExtent);
+        images.push_back(image);
+
+        if (name.empty() || file.images_.contains(name)) {
+            name += fmt::format("#{}", i);
         }
-    } else {
-        std::cerr << "Failed to determine glTF container" << std::endl;
-        return {};
+        file.images_[name] = image;
     }
 
+    const TextureTranscoder& transcoder = renderer->GetTextureTranscoder();
+    fmt::println("Textures: {:.1f} MB, {:.1f} MB as RGBA8, transcode cache {} hits {} misses", static_cast<double>(textureBytes) / (1024.0 * 1024.0),
+                 static_cast<double>(rgba8TextureBytes) / (1024.0 * 1024.0), transcoder.GetCacheHits(), transcoder.GetCacheMisses());
+    return images;
+}
+
+std::vector<std::shared_ptr<GltfMaterial>> CreateMaterials(SrsVkRenderer* renderer, LoadedGltf& file, std::span<const PackageMaterial> packageMaterials,
+                                                           std::span<const std::string> names, std::span<const AllocatedImage> images) {
     std::vector<DescriptorAllocatorGrowable::PoolSizeRatio> sizes = {
         {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3},
         {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3},
         {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1}
     };
 
-    file.descriptorPool_.Init(renderer->device_, gltf.materials.size(), sizes);
-
-    for (fastgltf::Sampler& sampler : gltf.samplers) {
-        VkSamplerCreateInfo sampl = {.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO, .pNext = nullptr};
-        sampl.maxLod = VK_LOD_CLAMP_NONE;
-        sampl.minLod = 0;
-
-        sampl.magFilter = ExtractFilter(sampler.magFilter.value_or(fastgltf::Filter::Nearest));
-        sampl.minFilter = ExtractFilter(sampler.minFilter.value_or(fastgltf::Filter::Nearest));
-
-        sampl.mipmapMode = ExtractMipMapMode(sampler.minFilter.value_or(fastgltf::Filter::Nearest));
-
-        VkSampler newSampler;
-        vkCreateSampler(renderer->device_, &sampl, nullptr, &newSampler);
+    file.descriptorPool_.Init(renderer->device_, packageMaterials.size(), sizes);
 
-        file.samplers_.push_back(newSampler);
-    }
-
-    std::vector<std::shared_ptr<MeshAsset>> meshes;
-    std::vector<std::shared_ptr<Node>> nodes;
-    std::vector<AllocatedImage> images;
-    std::vector<std::shared_ptr<GltfMaterial>> materials;
-
-    for (fastgltf::Image& image : gltf.images) {
-        images.push_back(renderer->errorCheckerboardImage_);
-    }
-    file.materialDataBuffer_ = renderer->CreateBuffer(sizeof(GltfMetallicRoughness::MaterialConstants) * gltf.materials.size(), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-    int dataIndex = 0;
+    file.materialDataBuffer_ = renderer->CreateBuffer(sizeof(GltfMetallicRoughness::MaterialConstants) * packageMaterials.size(), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
     auto sceneMaterialConstants = static_cast<GltfMetallicRoughness::MaterialConstants*>(file.materialDataBuffer_.info.pMappedData);
 
-    for (fastgltf::Material& mat : gltf.materials) {
+    std::vector<std::shared_ptr<GltfMaterial>> materials;
+    for (size_t dataIndex = 0; dataIndex < packageMaterials.size(); dataIndex++) {
+        const PackageMaterial& mat = packageMaterials[dataIndex];
         std::shared_ptr<GltfMaterial> newMat = std::make_shared<GltfMaterial>();
         materials.push_back(newMat);
-        file.materials_[mat.name.c_str()] = newMat;
+        file.materials_[names[dataIndex]] = newMat;
 
         GltfMetallicRoughness::MaterialConstants constants{};
-        constants.colorFactors.x = mat.pbrData.baseColorFactor[0];
-        constants.colorFactors.y = mat.pbrData.baseColorFactor[1];
-        constants.colorFactors.z = mat.pbrData.baseColorFactor[2];
-        constants.colorFactors.w = mat.pbrData.baseColorFactor[3];
-
-        constants.metalRoughFactors.x = mat.pbrData.metallicFactor;
-        constants.metalRoughFactors.y = mat.pbrData.roughnessFactor;
+        constants.colorFactors = mat.colorFactors;
+        constants.metalRoughFactors = mat.metalRoughFactors;
         // write material parameters to buffer
         sceneMaterialConstants[dataIndex] = constants;
 
-        MaterialPass passType = MaterialPass::kMainColor;
-        if (mat.alphaMode == fastgltf::AlphaMode::Blend) {
-            passType = MaterialPass::kTransparent;
-        }
-
         GltfMetallicRoughness::MaterialResources materialResources{};
         // default the material textures
         materialResources.colorImage = renderer->whiteImage_;
@@ -245,188 +187,352 @@ std::optional<std::shared_ptr<LoadedGltf>> LoadGltf(SrsVkRenderer* renderer, std
         // set the uniform buffer for the material data
         materialResources.dataBuffer = file.materialDataBuffer_.buffer;
         materialResources.dataBufferOffset = dataIndex * sizeof(GltfMetallicRoughness::MaterialConstants);
-        // grab textures from gltf file
-        if (mat.pbrData.baseColorTexture.has_value()) {
-            size_t img = gltf.textures[mat.pbrData.baseColorTexture.value().textureIndex].imageIndex.value();
-            size_t sampler = gltf.textures[mat.pbrData.baseColorTexture.value().textureIndex].samplerIndex.value();
 
-            materialResources.colorImage = images[img];
-            materialResources.colorSampler = file.samplers_[sampler];
+        if (mat.colorImage != kPackageNone) {
+            materialResources.colorImage = images[mat.colorImage];
+        }
+        if (mat.colorSampler != kPackageNone) {
+            materialResources.colorSampler = file.samplers_[mat.colorSampler];
         }
         // build material
-        newMat->data = renderer->metalRoughMaterial_.WriteMaterial(renderer->device_, passType, materialResources, file.descriptorPool_);
+        newMat->data = renderer->metalRoughMaterial_.WriteMaterial(renderer->device_, mat.passType, materialResources, file.descriptorPool_);
+        newMat->data.doubleSided = mat.doubleSided != 0;
+    }
+    return materials;
+}
 
-        dataIndex++;
+void PrintGeometryStats(std::span<const std::shared_ptr<MeshAsset>> meshes) {
+    size_t vertexBytes = 0;
+    size_t fullVertexBytes = 0;
+    size_t compactMeshes = 0;
+    size_t indexBytes = 0;
+    size_t shortIndexMeshes = 0;
+    for (const std::shared_ptr<MeshAsset>& mesh : meshes) {
+        const GpuMeshBuffers& buffers = mesh->meshBuffers;
+        vertexBytes += buffers.vertexRange.count * GetVertexStride(buffers.vertexFormat);
+        fullVertexBytes += buffers.vertexRange.count * sizeof(Vertex);
+        compactMeshes += buffers.vertexFormat == VertexFormat::kCompact;
+        indexBytes += buffers.indexRange.count * GetIndexSize(buffers.indexType);
+        shortIndexMeshes += buffers.indexType == VK_INDEX_TYPE_UINT16;
     }
+    fmt::println("Vertices: {:.1f} MB, {:.1f} MB as full vertices, {} of {} meshes compact", static_cast<double>(vertexBytes) / (1024.0 * 1024.0),
+                 static_cast<double>(fullVertexBytes) / (1024.0 * 1024.0), compactMeshes, meshes.size());
+    fmt::println("Indices: {:.1f} MB, {} of {} meshes with 16 bit indices", static_cast<double>(indexBytes) / (1024.0 * 1024.0), shortIndexMeshes, meshes.size());
+}
+
+// Surfaces without a material get the first one, if there is any
+std::shared_ptr<MeshAsset> CreateMesh(SrsVkRenderer* renderer, UploadBatch& uploads, std::string name, const IndexData& indices, const VertexData& vertices,
+                                      std::span<const Meshlet> meshlets, std::span<const PackageSurface> surfaces, const Bounds& bounds,
+                                      std::span<const std::shared_ptr<GltfMaterial>> materials) {
+    std::shared_ptr<MeshAsset> newMesh = std::make_shared<MeshAsset>();
+    newMesh->name = std::move(name);
+    newMesh->bounds = bounds;
+
+    for (const PackageSurface& packageSurface : surfaces) {
+        GeoSurface surface{};
+        surface.startIndex = packageSurface.startIndex;
+        surface.count = packageSurface.count;
+        surface.firstMeshlet = packageSurface.firstMeshlet;
+        surface.meshletCount = packageSurface.meshletCount;
+        surface.lodCount = packageSurface.lodCount;
+        surface.lods = packageSurface.lods;
+        surface.bounds = packageSurface.bounds;
+        if (packageSurface.material != kPackageNone) {
+            surface.material = materials[packageSurface.material];
+        } else if (!materials.empty()) {
+            surface.material = materials[0];
+        }
+        newMesh->surfaces.push_back(surface);
+    }
+
+    newMesh->meshBuffers = renderer->UploadMesh(uploads, indices, vertices, meshlets);
+    return newMesh;
+}
 
-    std::vector<uint32_t> indices;
-    std::vector<Vertex> vertices;
+void CreateNodes(LoadedGltf& file, std::span<const PackageNode> packageNodes, std::span<const std::string> names, std::span<const std::shared_ptr<MeshAsset>> meshes) {
+    std::vector<std::shared_ptr<Node>> nodes;
+    nodes.reserve(packageNodes.size());
 
-    for (fastgltf::Mesh& mesh : gltf.meshes) {
-        std::shared_ptr<MeshAsset> newmesh = std::make_shared<MeshAsset>();
-        meshes.push_back(newmesh);
-        file.meshes_[mesh.name.c_str()] = newmesh;
-        newmesh->name = mesh.name;
+    for (size_t i = 0; i < packageNodes.size(); i++) {
+        const PackageNode& packageNode = packageNodes[i];
+        std::shared_ptr<Node> newNode;
 
-        // clear the mesh arrays each mesh, we dont want to merge them by error
-        indices.clear();
-        vertices.clear();
+        // find if the node has a mesh, and if it does hook it to the mesh pointer and allocate it with the MeshNode class
+        if (packageNode.mesh != kPackageNone) {
+            newNode = std::make_shared<MeshNode>();
+            static_cast<MeshNode*>(newNode.get())->mesh_ = meshes[packageNode.mesh];
+        } else {
+            newNode = std::make_shared<Node>();
+        }
+        // Package nodes are parent sorted as well, so the transform index is the package index
+        newNode->transforms_ = &file.transforms_;
+        newNode->transformIndex_ = file.transforms_.Add(packageNode.parent != kPackageNone ? packageNode.parent : TransformHierarchy::kNoParent, packageNode.localTransform);
+
+        // Parents come first, so the parent already exists
+        if (packageNode.parent != kPackageNone) {
+            nodes[packageNode.parent]->children_.push_back(newNode);
+            newNode->parent_ = nodes[packageNode.parent];
+        } else {
+            file.topNodes_.push_back(newNode);
+        }
 
-        for (auto&& primitive : mesh.primitives) {
-            GeoSurface newSurface;
-            newSurface.startIndex = static_cast<uint32_t>(indices.size());
-            newSurface.count = static_cast<uint32_t>(gltf.accessors[primitive.indicesAccessor.value()].count);
+        nodes.push_back(newNode);
+        file.nodes_[names[i]] = newNode;
+    }
 
-            size_t initialVtx = vertices.size();
+    // Every node starts dirty, so this computes all transforms
+    file.flatNodes_ = std::move(nodes);
+    file.UpdateTransforms();
 
-            // load indexes
-            {
-                fastgltf::Accessor& indexaccessor = gltf.accessors[primitive.indicesAccessor.value()];
-                indices.reserve(indices.size() + indexaccessor.count);
+    // The draws start out at the final transforms, from here on only moved nodes touch them
+    DrawRegistry& registry = file.creator_->GetDrawRegistry();
+    for (size_t i = 0; i < packageNodes.size(); i++) {
+        if (packageNodes[i].mesh != kPackageNone) {
+            static_cast<MeshNode*>(file.flatNodes_[i].get())->Register(registry);
+        }
+    }
+}
+}
 
-                fastgltf::iterateAccessor<std::uint32_t>(gltf, indexaccessor,
-                                                         [&](std::uint32_t idx) {
-                                                             indices.push_back(idx + initialVtx);
-                                                         });
-            }
+uint32_t LoadedGltf::UpdateTransforms() {
+    const uint32_t updated = transforms_.Update();
+    if (updated == 0) {
+        return 0;
+    }
 
-            // load vertex positions
-            {
-                fastgltf::Accessor& posAccessor = gltf.accessors[primitive.findAttribute("POSITION")->accessorIndex];
-                vertices.resize(vertices.size() + posAccessor.count);
-
-                fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, posAccessor,
-                                                              [&](glm::vec3 v, size_t index) {
-                                                                  Vertex newVertex{};
-                                                                  newVertex.position = v;
-                                                                  newVertex.normal = {1, 0, 0};
-                                                                  newVertex.color = glm::vec4{1.f};
-                                                                  newVertex.uvX = 0;
-                                                                  newVertex.uvY = 0;
-                                                                  vertices[initialVtx + index] = newVertex;
-                                                              });
-            }
+    for (uint32_t i = transforms_.GetUpdatedBegin(); i < transforms_.GetUpdatedEnd(); i++) {
+        if (transforms_.WasUpdated(i)) {
+            flatNodes_[i]->OnTransformChanged();
+        }
+    }
+    return updated;
+}
 
-            // load vertex normals
-            if (auto normals = primitive.findAttribute("NORMAL"); normals != primitive.attributes.end()) {
-                fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, gltf.accessors[normals->accessorIndex], [&](glm::vec3 v, size_t index) {
-                    vertices[initialVtx + index].normal = v;
-                });
-            }
+void LoadedGltf::ClearAll() {
+    const VkDevice device = creator_->device_;
 
-            // load UVs
-            auto uv = primitive.findAttribute("TEXCOORD_0");
-            if (uv != primitive.attributes.end()) {
-                fastgltf::iterateAccessorWithIndex<glm::vec2>(gltf, gltf.accessors[uv->accessorIndex],
-                                                              [&](glm::vec2 v, size_t index) {
-                                                                  vertices[initialVtx + index].uvX = v.x;
-                                                                  vertices[initialVtx + index].uvY = v.y;
-                                                              });
-            }
+    // The draws reference the meshes and materials freed below
+    for (const auto& node : flatNodes_) {
+        node->Unregister();
+    }
+    for (const auto& material : materials_ | std::views::values) {
+        creator_->ReleaseMaterial(material->data);
+    }
 
-            // load vertex colors
-            auto colors = primitive.findAttribute("COLOR_0");
-            if (colors != primitive.attributes.end()) {
-                fastgltf::iterateAccessorWithIndex<glm::vec4>(gltf, gltf.accessors[colors->accessorIndex],
-                                                              [&](glm::vec4 v, size_t index) {
-                                                                  vertices[initialVtx + index].color = v;
-                                                              });
-            }
+    for (const auto& mesh : meshes_) {
+        creator_->FreeMesh(mesh->meshBuffers);
+    }
 
-            if (primitive.materialIndex.has_value()) {
-                newSurface.material = materials[primitive.materialIndex.value()];
-            } else {
-                newSurface.material = materials[0];
-            }
+    // Frames in flight may still sample the images and read the materials, everything goes once they are done. Images that failed to load
+    // point to the renderer defaults, those are not in the map
+    creator_->DeferDeletion([creator = creator_, device, images = std::move(images_), descriptorPool = std::move(descriptorPool_),
+                                materialDataBuffer = materialDataBuffer_, samplers = std::move(samplers_)]() mutable {
+        for (const AllocatedImage& image : images | std::views::values) {
+            creator->DestroyImage(image);
+        }
+
+        descriptorPool.DestroyPools(device);
+        creator->DestroyBuffer(materialDataBuffer);
 
-            newmesh->surfaces.push_back(newSurface);
+        for (const VkSampler sampler : samplers) {
+            vkDestroySampler(device, sampler, nullptr);
         }
+    });
+}
 
-        newmesh->meshBuffers = renderer->UploadMesh(indices, vertices);
+std::optional<std::vector<std::shared_ptr<MeshAsset>>> LoadGltfMeshes(sirius::SrsVkRenderer* engine, std::filesystem::path filePath) {
+    std::cout << "\n" << "Loading GLTF: " << filePath << "\n" << std::endl;
+
+    std::optional<fastgltf::Asset> gltf = ParseGltf(filePath);
+    if (!gltf) {
+        return {};
     }
 
-    // load all nodes and their meshes
-    for (fastgltf::Node& node : gltf.nodes) {
-        std::shared_ptr<Node> newNode;
+    std::vector<std::shared_ptr<MeshAsset>> meshes;
+    std::vector<DecodedMesh> decodedMeshes = DecodeMeshes(*gltf, engine->IsCompactVerticesEnabled());
 
-        // find if the node has a mesh, and if it does hook it to the mesh pointer and allocate it with the MeshNode class
-        if (node.meshIndex.has_value()) {
-            newNode = std::make_shared<MeshNode>();
-            static_cast<MeshNode*>(newNode.get())->mesh_ = meshes[*node.meshIndex];
-        } else {
-            newNode = std::make_shared<Node>();
+    UploadBatch uploads(engine->GetUploadService());
+    for (size_t i = 0; i < decodedMeshes.size(); i++) {
+        DecodedMesh& decoded = decodedMeshes[i];
+
+        // display the vertex normals
+        constexpr bool overrideColors = false;
+        if (overrideColors) {
+            for (Vertex& vtx : decoded.vertices) {
+                vtx.color = glm::vec4(vtx.normal, 1.f);
+            }
+            decoded.packedVertices = PackVertices(decoded.vertices, engine->IsCompactVerticesEnabled());
         }
+        meshes.push_back(CreateMesh(engine, uploads, gltf->meshes[i].name.c_str(), decoded.packedIndices.GetData(), decoded.packedVertices.GetData(), decoded.meshlets,
+                                    decoded.surfaces, decoded.bounds, {}));
+    }
 
-        nodes.push_back(newNode);
-        file.nodes_[node.name.c_str()];
-
-        std::visit(
-            fastgltf::visitor{
-                [&](const fastgltf::math::fmat4x4& matrix) {
-                    memcpy(&newNode->localTransform_, matrix.data(), sizeof(matrix));
-                },
-                [&](fastgltf::TRS transform) {
-                    const glm::vec3 tl(transform.translation[0], transform.translation[1], transform.translation[2]);
-                    const glm::quat rot(transform.rotation[3], transform.rotation[0], transform.rotation[1], transform.rotation[2]);
-                    const glm::vec3 sc(transform.scale[0], transform.scale[1], transform.scale[2]);
-
-                    const glm::mat4 tm = glm::translate(glm::mat4(1.f), tl);
-                    const glm::mat4 rm = glm::toMat4(rot);
-                    const glm::mat4 sm = glm::scale(glm::mat4(1.f), sc);
-
-                    newNode->localTransform_ = tm * rm * sm;
-                }
-            }, node.transform);
+    uploads.Submit();
+
+    return meshes;
+}
+
+std::optional<std::shared_ptr<LoadedGltf>> LoadGltf(SrsVkRenderer* renderer, std::string_view filePath) {
+    SRS_PROFILE_SCOPE("LoadGltf");
+    fmt::print("Loading GLTF: {}", filePath);
+
+    std::shared_ptr<LoadedGltf> scene = std::make_shared<LoadedGltf>();
+    scene->creator_ = renderer;
+    LoadedGltf& file = *scene;
+    GltfLoadTimings& timings = file.loadTimings_;
+    auto stageStart = std::chrono::high_resolution_clock::now();
+
+    const std::filesystem::path path = filePath;
+    std::optional<fastgltf::Asset> parsed = ParseGltf(path);
+    if (!parsed) {
+        return {};
+    }
+    const fastgltf::Asset& gltf = *parsed;
+    timings.parseMs = MillisecondsSince(stageStart);
+
+    stageStart = std::chrono::high_resolution_clock::now();
+    std::vector<DecodedImage> decodedImages;
+    {
+        SRS_PROFILE_SCOPE("Decode images");
+        decodedImages = DecodeGltfImages(gltf, path.parent_path(), renderer->GetTextureTranscoder());
     }
+    timings.imageDecodeMs = MillisecondsSince(stageStart);
+    stageStart = std::chrono::high_resolution_clock::now();
 
-    // Set up hierarchy
-    for (int i = 0; i < gltf.nodes.size(); i++) {
-        fastgltf::Node& node = gltf.nodes[i];
-        std::shared_ptr<Node>& sceneNode = nodes[i];
+    // Every mesh and image of the file goes to the GPU in one submit
+    UploadBatch uploads(renderer->GetUploadService());
 
-        for (auto& c : node.children) {
-            sceneNode->children_.push_back(nodes[c]);
-            nodes[c]->parent_ = sceneNode;
-        }
+    CreateSamplers(renderer->device_, file, ConvertSamplers(gltf));
+
+    std::vector<std::string> imageNames;
+    for (const fastgltf::Image& image : gltf.images) {
+        imageNames.emplace_back(image.name.c_str());
+    }
+    const std::vector<AllocatedImage> images = CreateImages(renderer, file, uploads, decodedImages, imageNames);
+    decodedImages.clear();
+
+    std::vector<PackageMaterial> packageMaterials;
+    std::vector<std::string> materialNames;
+    for (const fastgltf::Material& material : gltf.materials) {
+        packageMaterials.push_back(ConvertMaterial(gltf, material));
+        materialNames.emplace_back(material.name.c_str());
     }
+    const std::vector<std::shared_ptr<GltfMaterial>> materials = CreateMaterials(renderer, file, packageMaterials, materialNames, images);
 
-    // find the top nodes, with no parents
-    for (auto& node : nodes) {
-        if (node->parent_.lock() == nullptr) {
-            file.topNodes_.push_back(node);
-            node->RefreshTransform(glm::mat4 { 1.f });
+    timings.materialMs = MillisecondsSince(stageStart);
+
+    stageStart = std::chrono::high_resolution_clock::now();
+    std::vector<DecodedMesh> decodedMeshes;
+    {
+        SRS_PROFILE_SCOPE("Decode meshes");
+        decodedMeshes = DecodeMeshes(gltf, renderer->IsCompactVerticesEnabled());
+    }
+    timings.decodeMs = MillisecondsSince(stageStart);
+    timings.decodeThreads = JobSystem::GetWorkerCount() + 1;
+
+    const MeshOptimizationStats optimization = GetOptimizationStats(decodedMeshes);
+    fmt::println("Optimized meshes: {} -> {} vertices, ACMR {:.3f} -> {:.3f}, {} -> {} triangles at the coarsest LOD", optimization.verticesBefore,
+                 optimization.verticesAfter, optimization.GetAcmrBefore(), optimization.GetAcmrAfter(), optimization.triangleCount, optimization.coarsestLodTriangles);
+
+    stageStart = std::chrono::high_resolution_clock::now();
+    std::vector<std::shared_ptr<MeshAsset>> meshes;
+    {
+        SRS_PROFILE_SCOPE("Upload meshes");
+        for (size_t i = 0; i < decodedMeshes.size(); i++) {
+            const DecodedMesh& decoded = decodedMeshes[i];
+            std::shared_ptr<MeshAsset> newmesh = CreateMesh(renderer, uploads, gltf.meshes[i].name.c_str(), decoded.packedIndices.GetData(), decoded.packedVertices.GetData(),
+                                                            decoded.meshlets, decoded.surfaces, decoded.bounds, materials);
+            meshes.push_back(newmesh);
+            file.meshes_.push_back(newmesh);
         }
+
+        uploads.Submit();
+    }
+    timings.uploadMs = MillisecondsSince(stageStart);
+    fmt::println("Uploaded {} buffers and images, {:.1f} MB", uploads.GetUploadCount(), static_cast<double>(uploads.GetUploadedBytes()) / (1024.0 * 1024.0));
+    PrintGeometryStats(meshes);
+
+    stageStart = std::chrono::high_resolution_clock::now();
+    std::vector<uint32_t> gltfIndices;
+    const std::vector<PackageNode> nodes = ConvertNodes(gltf, gltfIndices);
+    std::vector<std::string> nodeNames;
+    for (const uint32_t gltfIndex : gltfIndices) {
+        // GPU instances have no name of their own
+        nodeNames.emplace_back(gltfIndex != kPackageNone ? gltf.nodes[gltfIndex].name.c_str() : "");
     }
+    CreateNodes(file, nodes, nodeNames, meshes);
+    timings.sceneMs = MillisecondsSince(stageStart);
+
+    fmt::println("Loaded {} meshes and {} images: parse {:.1f} ms, images {:.1f} ms, materials {:.1f} ms, decode {:.1f} ms on {} threads, upload {:.1f} ms, scene {:.1f} ms",
+                 gltf.meshes.size(), gltf.images.size(), timings.parseMs, timings.imageDecodeMs, timings.materialMs, timings.decodeMs, timings.decodeThreads,
+                 timings.uploadMs, timings.sceneMs);
     return scene;
 }
 
-VkFilter ExtractFilter(fastgltf::Filter filter) {
-    switch (filter) {
-        // nearest samplers
-        case fastgltf::Filter::Nearest:
-        case fastgltf::Filter::NearestMipMapNearest:
-        case fastgltf::Filter::NearestMipMapLinear:
-            return VK_FILTER_NEAREST;
-
-        // linear samplers
-        case fastgltf::Filter::Linear:
-        case fastgltf::Filter::LinearMipMapNearest:
-        case fastgltf::Filter::LinearMipMapLinear:
-        default:
-            return VK_FILTER_LINEAR;
+std::optional<std::shared_ptr<LoadedGltf>> LoadScenePackage(SrsVkRenderer* renderer, std::string_view filePath) {
+    SRS_PROFILE_SCOPE("LoadScenePackage");
+    fmt::println("Loading scene package: {}", filePath);
+
+    std::shared_ptr<LoadedGltf> scene = std::make_shared<LoadedGltf>();
+    scene->creator_ = renderer;
+    LoadedGltf& file = *scene;
+    GltfLoadTimings& timings = file.loadTimings_;
+    auto stageStart = std::chrono::high_resolution_clock::now();
+
+    // Uploads copy out of the mapping, it is only needed until the end of the function
+    ScenePackage package;
+    if (!package.Open(filePath)) {
+        std::cerr << "Failed to open scene package, cook it again with sirius-cook" << std::endl;
+        return {};
     }
-}
+    timings.parseMs = MillisecondsSince(stageStart);
+
+    stageStart = std::chrono::high_resolution_clock::now();
+    std::vector<DecodedImage> decodedImages;
+    {
+        SRS_PROFILE_SCOPE("Decode images");
+        decodedImages = DecodePackageImages(package, renderer->GetTextureTranscoder());
+    }
+    timings.imageDecodeMs = MillisecondsSince(stageStart);
+    timings.decodeThreads = JobSystem::GetWorkerCount() + 1;
+    stageStart = std::chrono::high_resolution_clock::now();
+
+    UploadBatch uploads(renderer->GetUploadService());
 
-VkSamplerMipmapMode ExtractMipMapMode(fastgltf::Filter filter) {
-    switch (filter) {
-        case fastgltf::Filter::NearestMipMapNearest:
-        case fastgltf::Filter::LinearMipMapNearest:
-            return VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    CreateSamplers(renderer->device_, file, package.GetSamplers());
+    const std::vector<AllocatedImage> images = CreateImages(renderer, file, uploads, decodedImages, GetNames(package, package.GetImages()));
+    decodedImages.clear();
+    const std::vector<std::shared_ptr<GltfMaterial>> materials = CreateMaterials(renderer, file, package.GetMaterials(), GetNames(package, package.GetMaterials()), images);
+    timings.materialMs = MillisecondsSince(stageStart);
 
-        case fastgltf::Filter::NearestMipMapLinear:
-        case fastgltf::Filter::LinearMipMapLinear:
-        default:
-            return VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    // Geometry is stored ready for the GPU, it is copied to the staging ring as it is
+    stageStart = std::chrono::high_resolution_clock::now();
+    std::vector<std::shared_ptr<MeshAsset>> meshes;
+    {
+        SRS_PROFILE_SCOPE("Upload meshes");
+        const std::span<const Meshlet> meshlets = package.GetMeshlets();
+        const std::span<const PackageSurface> surfaces = package.GetSurfaces();
+
+        for (const PackageMesh& mesh : package.GetMeshes()) {
+            std::shared_ptr<MeshAsset> newMesh = CreateMesh(renderer, uploads, std::string(package.GetString(mesh.name)), package.GetIndices(mesh), package.GetVertices(mesh),
+                                                            meshlets.subspan(mesh.firstMeshlet, mesh.meshletCount), surfaces.subspan(mesh.firstSurface, mesh.surfaceCount),
+                                                            mesh.bounds, materials);
+            meshes.push_back(newMesh);
+            file.meshes_.push_back(newMesh);
+        }
+
+        uploads.Submit();
     }
+    timings.uploadMs = MillisecondsSince(stageStart);
+    PrintGeometryStats(meshes);
+
+    stageStart = std::chrono::high_resolution_clock::now();
+    CreateNodes(file, package.GetNodes(), GetNames(package, package.GetNodes()), meshes);
+    timings.sceneMs = MillisecondsSince(stageStart);
+
+    fmt::println("Loaded {} meshes and {} images from {:.1f} MB: map {:.1f} ms, images {:.1f} ms, materials {:.1f} ms, upload {:.1f} ms, scene {:.1f} ms", meshes.size(),
+                 images.size(), static_cast<double>(package.GetFileSize()) / (1024.0 * 1024.0), timings.parseMs, timings.imageDecodeMs, timings.materialMs,
+                 timings.uploadMs, timings.sceneMs);
+    return scene;
 }
 }
@@ -3,6 +3,7 @@
 //
 
 #pragma once
+#include <array>
 #include <filesystem>
 #include <memory>
 #include <optional>
@@ -11,8 +12,8 @@
 #include <vector>
 
 #include "descriptors.h"
+#include "gltf_decode.h"
 #include "types.h"
-#include "fastgltf/types.hpp"
 
 namespace sirius {
 class SrsVkRenderer;
@@ -24,23 +25,47 @@ struct GltfMaterial {
 struct GeoSurface {
     uint32_t startIndex;
     uint32_t count;
+    // Relative to the mesh's first meshlet
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+    // Simplified levels from fine to coarse, the renderer picks one by its error on screen
+    uint32_t lodCount;
+    std::array<SurfaceLod, kMaxLodLevels - 1> lods;
+    Bounds bounds;
     std::shared_ptr<GltfMaterial> material;
 };
 
 struct MeshAsset {
     std::string name;
     std::vector<GeoSurface> surfaces;
+    // Union of the surface bounds, in mesh space
+    Bounds bounds;
     GpuMeshBuffers meshBuffers;
 };
 
-class LoadedGltf : public IRenderable {
+// Wall clock time of each stage of LoadGltf. Scene packages report mapping the file as parsing and have no decode stage
+struct GltfLoadTimings {
+    double parseMs;
+    // Images are decoded in parallel too, their uploads are recorded with the materials
+    double imageDecodeMs;
+    double materialMs;
+    // Meshes are decoded and optimized in parallel, the upload stage copies all of them into one batch
+    double decodeMs;
+    double uploadMs;
+    double sceneMs;
+    uint32_t decodeThreads;
+};
+
+class LoadedGltf {
 public:
-    ~LoadedGltf() override { ClearAll(); };
+    ~LoadedGltf() { ClearAll(); };
 
-    void Draw(const glm::mat4& topMatrix, DrawContext& ctx) override;
+    // Recomputes the world transforms that changed and passes them on to the draws of the moved nodes, returns the number of moved nodes
+    uint32_t UpdateTransforms();
 
     // storage for all the data on a given glTF file
-    std::unordered_map<std::string, std::shared_ptr<MeshAsset> > meshes_;
+    // In file order, mesh names may be empty or repeated
+    std::vector<std::shared_ptr<MeshAsset> > meshes_;
     std::unordered_map<std::string, std::shared_ptr<Node> > nodes_;
     std::unordered_map<std::string, AllocatedImage> images_;
     std::unordered_map<std::string, std::shared_ptr<GltfMaterial> > materials_;
@@ -48,6 +73,10 @@ public:
     // nodes that don't have a parent, for iterating through the file in tree order
     std::vector<std::shared_ptr<Node> > topNodes_;
 
+    // Every node in the order of their transforms, parents before children
+    TransformHierarchy transforms_;
+    std::vector<std::shared_ptr<Node> > flatNodes_;
+
     std::vector<VkSampler> samplers_;
 
     DescriptorAllocatorGrowable descriptorPool_;
@@ -56,6 +85,8 @@ public:
 
     SrsVkRenderer* creator_;
 
+    GltfLoadTimings loadTimings_{};
+
 private:
     void ClearAll();
 };
@@ -63,8 +94,8 @@ private:
 std::optional<std::vector<std::shared_ptr<MeshAsset> > > LoadGltfMeshes(SrsVkRenderer* engine, std::filesystem::path filePath);
 std::optional<std::shared_ptr<LoadedGltf>> LoadGltf(SrsVkRenderer* renderer,std::string_view filePath);
 
-VkFilter ExtractFilter(fastgltf::Filter filter);
-VkSamplerMipmapMode ExtractMipMapMode(fastgltf::Filter filter);
+// Loads a scene cooked by sirius-cook. The geometry is uploaded straight from the mapped file
+std::optional<std::shared_ptr<LoadedGltf>> LoadScenePackage(SrsVkRenderer* renderer, std::string_view filePath);
 
 
 }
@@ -10,9 +10,12 @@
 
 namespace sirius {
 void Camera::Init() {
+#ifdef _WIN32
     InputManager::Subscribe([this](const InputEvent& e) { ProcessWindowEvent(e); });
+#endif
 }
 
+#ifdef _WIN32
 void Camera::ProcessWindowEvent(InputEvent event) {
     std::visit( Overload{
         [this](MouseMoveEvent e) {
@@ -41,6 +44,7 @@ void Camera::ProcessWindowEvent(InputEvent event) {
         }
     }, event.data);
 }
+#endif
 
 void Camera::Update() {
     glm::mat4 cameraRotation = GetRotationMatrix();
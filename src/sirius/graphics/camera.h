@@ -7,7 +7,10 @@
 #include <vec3.hpp>
 #include <mat4x4.hpp>
 
+#ifdef _WIN32
 #include "input/input_manager.h"
+#endif
+
 namespace sirius {
 template<class... Ts> struct Overload : Ts...{using Ts::operator()...; };
 
@@ -16,7 +19,9 @@ class Camera {
 public:
     void Init();
 
+#ifdef _WIN32
     void ProcessWindowEvent(sirius::InputEvent event);
+#endif
 
     void Update();
 
@@ -0,0 +1,114 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "camera_path.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace sirius {
+namespace {
+template<typename T>
+T CatmullRom(const T& p0, const T& p1, const T& p2, const T& p3, float t) {
+    const float t2 = t * t;
+    const float t3 = t2 * t;
+    return 0.5f * ((2.0f * p1) + (-p0 + p2) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3);
+}
+}
+
+std::optional<CameraPath> CameraPath::LoadFromFile(const std::filesystem::path& filePath) {
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        return {};
+    }
+
+    CameraPath path;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream stream(line);
+        Keyframe keyframe{};
+        if (!(stream >> keyframe.time >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z >> keyframe.pitch >> keyframe.yaw)) {
+            return {};
+        }
+        if (!path.AddKeyframe(keyframe)) {
+            return {};
+        }
+    }
+
+    if (path.IsEmpty()) {
+        return {};
+    }
+    return path;
+}
+
+bool CameraPath::SaveToFile(const std::filesystem::path& filePath) const {
+    std::ofstream file(filePath);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file << "# time x y z pitch yaw\n";
+    for (const auto& [time, position, pitch, yaw] : keyframes_) {
+        file << time << " " << position.x << " " << position.y << " " << position.z << " " << pitch << " " << yaw << "\n";
+    }
+    return true;
+}
+
+bool CameraPath::AddKeyframe(const Keyframe& keyframe) {
+    // Evaluate searches the times and divides by the length of each segment
+    if (!keyframes_.empty() && !(keyframe.time > keyframes_.back().time)) {
+        return false;
+    }
+    keyframes_.push_back(keyframe);
+    return true;
+}
+
+CameraPath::Keyframe CameraPath::Evaluate(float time) const {
+    if (keyframes_.size() == 1 || time <= keyframes_.front().time) {
+        return keyframes_.front();
+    }
+    if (time >= keyframes_.back().time) {
+        return keyframes_.back();
+    }
+
+    // First keyframe that comes after the requested time, the segment runs from the one before it
+    const auto next = std::ranges::upper_bound(keyframes_, time, {}, &Keyframe::time);
+    const size_t i1 = std::distance(keyframes_.begin(), next) - 1;
+    const size_t i0 = i1 == 0 ? 0 : i1 - 1;
+    const size_t i2 = i1 + 1;
+    const size_t i3 = std::min(i2 + 1, keyframes_.size() - 1);
+
+    const Keyframe& k0 = keyframes_[i0];
+    const Keyframe& k1 = keyframes_[i1];
+    const Keyframe& k2 = keyframes_[i2];
+    const Keyframe& k3 = keyframes_[i3];
+
+    const float t = (time - k1.time) / (k2.time - k1.time);
+
+    Keyframe result{};
+    result.time = time;
+    result.position = CatmullRom(k0.position, k1.position, k2.position, k3.position, t);
+    result.pitch = CatmullRom(k0.pitch, k1.pitch, k2.pitch, k3.pitch, t);
+    result.yaw = CatmullRom(k0.yaw, k1.yaw, k2.yaw, k3.yaw, t);
+    return result;
+}
+
+void CameraPath::Apply(Camera& camera, float time) const {
+    const Keyframe keyframe = Evaluate(time);
+    camera.position_ = keyframe.position;
+    camera.pitch_ = keyframe.pitch;
+    camera.yaw_ = keyframe.yaw;
+    camera.velocity_ = glm::vec3(0.0f);
+}
+
+float CameraPath::GetDuration() const {
+    return keyframes_.empty() ? 0.0f : keyframes_.back().time;
+}
+}
@@ -0,0 +1,46 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+#include <vec3.hpp>
+
+#include "camera.h"
+
+namespace sirius {
+// Camera flight recorded as timed keyframes, replayed along a Catmull-Rom spline so benchmarks see the same views every run
+class CameraPath {
+public:
+    struct Keyframe {
+        float time;
+        glm::vec3 position;
+        float pitch;
+        float yaw;
+    };
+
+    // One keyframe per line: time x y z pitch yaw. Empty lines and lines starting with # are skipped, a file whose times do not strictly
+    // increase is rejected
+    static std::optional<CameraPath> LoadFromFile(const std::filesystem::path& filePath);
+
+    bool SaveToFile(const std::filesystem::path& filePath) const;
+
+    // Keyframes have to be added in strictly increasing time order, false and nothing added otherwise
+    bool AddKeyframe(const Keyframe& keyframe);
+
+    [[nodiscard]] Keyframe Evaluate(float time) const;
+
+    // Places the camera at the given time and stops any movement so Camera::Update doesn't drift from the path
+    void Apply(Camera& camera, float time) const;
+
+    [[nodiscard]] float GetDuration() const;
+
+    [[nodiscard]] bool IsEmpty() const { return keyframes_.empty(); }
+
+private:
+    std::vector<Keyframe> keyframes_;
+};
+}
@@ -0,0 +1,68 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "culling.h"
+
+#include <algorithm>
+#include <glm/glm.hpp>
+
+namespace sirius {
+Bounds MergeBounds(const Bounds& a, const Bounds& b) {
+    const glm::vec3 min = glm::min(a.origin - a.extents, b.origin - b.extents);
+    const glm::vec3 max = glm::max(a.origin + a.extents, b.origin + b.extents);
+
+    Bounds merged{};
+    merged.origin = (min + max) * 0.5f;
+    merged.extents = (max - min) * 0.5f;
+    // The sphere around the new origin that still contains both spheres
+    merged.sphereRadius = std::max(glm::distance(merged.origin, a.origin) + a.sphereRadius, glm::distance(merged.origin, b.origin) + b.sphereRadius);
+    return merged;
+}
+
+Bounds TransformBounds(const Bounds& bounds, const glm::mat4& transform) {
+    const glm::mat3 linear{transform};
+    const glm::mat3 absolute{glm::abs(linear[0]), glm::abs(linear[1]), glm::abs(linear[2])};
+    const float maxScale = std::max({glm::length(linear[0]), glm::length(linear[1]), glm::length(linear[2])});
+
+    Bounds transformed{};
+    transformed.origin = glm::vec3(transform * glm::vec4(bounds.origin, 1.0f));
+    transformed.extents = absolute * bounds.extents;
+    transformed.sphereRadius = bounds.sphereRadius * maxScale;
+    return transformed;
+}
+
+Frustum Frustum::FromMatrix(const glm::mat4& viewProjection) {
+    // Gribb/Hartmann plane extraction, the rows of the matrix combined for each clip plane (0 <= z <= w)
+    const glm::mat4 m = glm::transpose(viewProjection);
+
+    Frustum frustum{};
+    frustum.planes[0] = m[3] + m[0];
+    frustum.planes[1] = m[3] - m[0];
+    frustum.planes[2] = m[3] + m[1];
+    frustum.planes[3] = m[3] - m[1];
+    frustum.planes[4] = m[2];
+    frustum.planes[5] = m[3] - m[2];
+
+    for (auto& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+bool Frustum::IsVisible(const Bounds& bounds) const {
+    for (const auto& plane : planes) {
+        const glm::vec3 normal{plane};
+        const float distance = glm::dot(normal, bounds.origin) + plane.w;
+
+        // The sphere is cheaper to test, the box is tighter for long thin geometry
+        if (distance < -bounds.sphereRadius) {
+            return false;
+        }
+        if (distance < -glm::dot(bounds.extents, glm::abs(normal))) {
+            return false;
+        }
+    }
+    return true;
+}
+}
@@ -0,0 +1,33 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <array>
+#include <mat4x4.hpp>
+#include <vec3.hpp>
+#include <vec4.hpp>
+
+namespace sirius {
+// Axis aligned box around origin together with a bounding sphere around the same point
+struct Bounds {
+    glm::vec3 origin;
+    float sphereRadius;
+    glm::vec3 extents;
+};
+
+Bounds MergeBounds(const Bounds& a, const Bounds& b);
+
+// Conservative bounds after the transform, the box stays axis aligned
+Bounds TransformBounds(const Bounds& bounds, const glm::mat4& transform);
+
+struct Frustum {
+    // xyz is the inward facing normal, w the distance
+    std::array<glm::vec4, 6> planes;
+
+    static Frustum FromMatrix(const glm::mat4& viewProjection);
+
+    [[nodiscard]] bool IsVisible(const Bounds& bounds) const;
+};
+}
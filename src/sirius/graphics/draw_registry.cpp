@@ -0,0 +1,129 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "draw_registry.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace sirius {
+DrawHandle DrawRegistry::Register(const MeshAsset& mesh, const glm::mat4& transform) {
+    DrawHandle handle;
+    if (freeHandles_.empty()) {
+        handle = static_cast<DrawHandle>(groupSlots_.size());
+        groupSlots_.push_back(kInvalidHandle);
+    } else {
+        handle = freeHandles_.back();
+        freeHandles_.pop_back();
+    }
+    groupSlots_[handle] = static_cast<uint32_t>(groups_.size());
+
+    DrawGroup group{};
+    group.handle = handle;
+    group.objects.reserve(mesh.surfaces.size());
+
+    const GpuMeshBuffers& buffers = mesh.meshBuffers;
+    for (const GeoSurface& surface : mesh.surfaces) {
+        RenderObject object{};
+        object.indexCount = surface.count;
+        object.firstIndex = buffers.firstIndex + surface.startIndex;
+        object.indexBuffer = buffers.indexBuffer;
+        object.indexType = buffers.indexType;
+        object.material = &surface.material->data;
+        object.transform = transform;
+        object.vertexBufferAddress = buffers.vertexBufferAddress;
+        object.vertexOffset = buffers.vertexOffset;
+        object.vertexFormat = buffers.vertexFormat;
+        object.quantization = buffers.quantization;
+        object.bounds = surface.bounds;
+        object.meshletBufferAddress = buffers.meshletBufferAddress + surface.firstMeshlet * sizeof(Meshlet);
+        object.meshletCount = surface.meshletCount;
+        object.indexBufferAddress = buffers.indexBufferAddress;
+
+        group.meshBounds = group.objects.empty() ? surface.bounds : MergeBounds(group.meshBounds, surface.bounds);
+        entries_.push_back({&mesh, &surface, TransformBounds(surface.bounds, transform), handle, static_cast<uint32_t>(group.objects.size())});
+        group.objects.push_back(GetCount());
+        objects_.push_back(object);
+    }
+    group.worldBounds = TransformBounds(group.meshBounds, transform);
+
+    groups_.push_back(std::move(group));
+    layoutVersion_++;
+    return handle;
+}
+
+void DrawRegistry::Unregister(DrawHandle handle) {
+    const uint32_t groupIndex = groupSlots_[handle];
+    assert(groupIndex != kInvalidHandle);
+
+    if (groups_[groupIndex].moved) {
+        std::erase(movedGroups_, handle);
+    }
+    while (!groups_[groupIndex].objects.empty()) {
+        RemoveObject(groups_[groupIndex].objects.back());
+    }
+
+    // The last group takes the freed place, its objects refer to it by handle
+    const auto last = static_cast<uint32_t>(groups_.size() - 1);
+    if (groupIndex != last) {
+        groups_[groupIndex] = std::move(groups_[last]);
+        groupSlots_[groups_[groupIndex].handle] = groupIndex;
+    }
+    groups_.pop_back();
+
+    groupSlots_[handle] = kInvalidHandle;
+    freeHandles_.push_back(handle);
+    layoutVersion_++;
+}
+
+void DrawRegistry::RemoveObject(uint32_t index) {
+    // The group's last object takes the freed place in its list
+    DrawGroup& group = groups_[groupSlots_[entries_[index].group]];
+    const uint32_t groupSlot = entries_[index].groupSlot;
+    group.objects[groupSlot] = group.objects.back();
+    entries_[group.objects[groupSlot]].groupSlot = groupSlot;
+    group.objects.pop_back();
+
+    // The last object takes the freed place
+    const uint32_t last = GetCount() - 1;
+    if (index != last) {
+        objects_[index] = objects_[last];
+        entries_[index] = entries_[last];
+        const Entry& moved = entries_[index];
+        groups_[groupSlots_[moved.group]].objects[moved.groupSlot] = index;
+    }
+    objects_.pop_back();
+    entries_.pop_back();
+}
+
+void DrawRegistry::SetTransform(DrawHandle handle, const glm::mat4& transform) {
+    DrawGroup& group = groups_[groupSlots_[handle]];
+    group.worldBounds = TransformBounds(group.meshBounds, transform);
+    for (const uint32_t index : group.objects) {
+        objects_[index].transform = transform;
+        entries_[index].worldBounds = TransformBounds(entries_[index].surface->bounds, transform);
+    }
+
+    if (!group.moved) {
+        group.moved = true;
+        movedGroups_.push_back(handle);
+    }
+}
+
+void DrawRegistry::ClearMoved() {
+    for (const DrawHandle handle : movedGroups_) {
+        groups_[groupSlots_[handle]].moved = false;
+    }
+    movedGroups_.clear();
+}
+
+void DrawRegistry::SetLod(uint32_t index, const SurfaceLod& lod) {
+    const GpuMeshBuffers& buffers = entries_[index].mesh->meshBuffers;
+    RenderObject& object = objects_[index];
+    object.indexCount = lod.count;
+    object.firstIndex = buffers.firstIndex + lod.startIndex;
+    object.meshletBufferAddress = buffers.meshletBufferAddress + lod.firstMeshlet * sizeof(Meshlet);
+    object.meshletCount = lod.meshletCount;
+}
+}
@@ -0,0 +1,112 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <mat4x4.hpp>
+#include <span>
+#include <vector>
+
+#include "asset_loader.h"
+#include "types.h"
+
+namespace sirius {
+struct RenderObject {
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    VkBuffer indexBuffer;
+    VkIndexType indexType;
+
+    MaterialInstance* material;
+
+    glm::mat4 transform;
+    VkDeviceAddress vertexBufferAddress;
+    int32_t vertexOffset;
+    VertexFormat vertexFormat;
+    VertexQuantization quantization;
+
+    // Mesh space, used by the GPU culling pass
+    Bounds bounds;
+
+    // The surface's meshlets and the page its indices live in, for meshlet culling
+    VkDeviceAddress meshletBufferAddress;
+    uint32_t meshletCount;
+    VkDeviceAddress indexBufferAddress;
+};
+
+using DrawHandle = uint32_t;
+
+// The objects of one registered mesh, one per surface. They share its transform, culling rejects them together against the merged bounds
+struct DrawGroup {
+    Bounds meshBounds;
+    Bounds worldBounds;
+    // Dense indices of the objects
+    std::vector<uint32_t> objects;
+    DrawHandle handle;
+    // Listed in the moved groups
+    bool moved;
+};
+
+// Render objects that persist across frames. Every registered mesh keeps its objects until it is unregistered, moving it only rewrites their
+// transforms and world bounds and lists it as moved. Objects and groups are stored densely and move on Unregister, handles stay valid until then
+class DrawRegistry {
+public:
+    static constexpr DrawHandle kInvalidHandle = UINT32_MAX;
+
+    // The mesh must outlive the registration
+    DrawHandle Register(const MeshAsset& mesh, const glm::mat4& transform);
+
+    void Unregister(DrawHandle handle);
+
+    void SetTransform(DrawHandle handle, const glm::mat4& transform);
+
+    // Points the object at one level of its surface, by dense index
+    void SetLod(uint32_t index, const SurfaceLod& lod);
+
+    [[nodiscard]] std::span<const RenderObject> GetObjects() const { return objects_; }
+
+    [[nodiscard]] const GeoSurface& GetSurface(uint32_t index) const { return *entries_[index].surface; }
+
+    [[nodiscard]] const Bounds& GetWorldBounds(uint32_t index) const { return entries_[index].worldBounds; }
+
+    [[nodiscard]] uint32_t GetCount() const { return static_cast<uint32_t>(objects_.size()); }
+
+    [[nodiscard]] std::span<const DrawGroup> GetGroups() const { return groups_; }
+
+    [[nodiscard]] const DrawGroup& GetGroup(DrawHandle handle) const { return groups_[groupSlots_[handle]]; }
+
+    // Groups whose transform changed since the last ClearMoved
+    [[nodiscard]] std::span<const DrawHandle> GetMovedGroups() const { return movedGroups_; }
+
+    void ClearMoved();
+
+    // Changes with every registration and removal, the dense indices stay the same while it does not
+    [[nodiscard]] uint64_t GetLayoutVersion() const { return layoutVersion_; }
+
+private:
+    struct Entry {
+        const MeshAsset* mesh;
+        const GeoSurface* surface;
+        Bounds worldBounds;
+        DrawHandle group;
+        // Where the object is listed in its group
+        uint32_t groupSlot;
+    };
+
+    void RemoveObject(uint32_t index);
+
+    // Indexed like objects_
+    std::vector<RenderObject> objects_;
+    std::vector<Entry> entries_;
+
+    std::vector<DrawGroup> groups_;
+    // Dense index of every handle, kInvalidHandle for free ones
+    std::vector<uint32_t> groupSlots_;
+    std::vector<DrawHandle> freeHandles_;
+
+    std::vector<DrawHandle> movedGroups_;
+    uint64_t layoutVersion_ = 0;
+};
+}
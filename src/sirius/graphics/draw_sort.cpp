@@ -0,0 +1,91 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "draw_sort.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <functional>
+
+namespace sirius {
+uint32_t SortKeyIds::Get(const void* handle) {
+    if (const auto it = ids_.find(handle); it != ids_.end()) {
+        return it->second;
+    }
+
+    // The last id is shared by every handle that did not fit, those are not tracked
+    uint32_t id;
+    if (!freeIds_.empty()) {
+        id = freeIds_.back();
+        freeIds_.pop_back();
+    } else if (nextId_ < capacity_ - 1) {
+        id = nextId_++;
+    } else {
+        return capacity_ - 1;
+    }
+    ids_.emplace(handle, id);
+    return id;
+}
+
+void SortKeyIds::Release(const void* handle) {
+    if (const auto it = ids_.find(handle); it != ids_.end()) {
+        freeIds_.push_back(it->second);
+        ids_.erase(it);
+    }
+}
+
+size_t InstanceKeyHash::operator()(const InstanceKey& key) const {
+    // Boost style combine, the members are already well spread pointers and offsets
+    size_t hash = std::hash<const void*>{}(key.material);
+    const auto combine = [&hash](uint64_t value) {
+        hash ^= std::hash<uint64_t>{}(value) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    };
+    combine(reinterpret_cast<uintptr_t>(key.indexBuffer));
+    combine(key.vertexBuffer);
+    combine(key.firstIndex);
+    combine(key.indexCount);
+    combine(static_cast<uint32_t>(key.vertexOffset));
+    return hash;
+}
+
+uint64_t BuildSortKey(uint32_t pipelineId, uint32_t materialId, uint32_t indexBufferId, float viewDepth) {
+    // The bits of a positive float grow with its value, the upper half keeps a logarithmic spread of depth
+    const uint32_t depthBits = std::bit_cast<uint32_t>(std::max(viewDepth, 0.0f)) >> 16;
+
+    // SortKeyIds keeps every id inside its field
+    assert(pipelineId < 1u << kPipelineIdBits && materialId < 1u << kMaterialIdBits && indexBufferId < 1u << kIndexBufferIdBits);
+    return static_cast<uint64_t>(pipelineId) << (64 - kPipelineIdBits) |
+           static_cast<uint64_t>(materialId) << (64 - kPipelineIdBits - kMaterialIdBits) |
+           static_cast<uint64_t>(indexBufferId) << 16 |
+           static_cast<uint64_t>(depthBits & 0xFFFF);
+}
+
+void RadixSort(std::vector<DrawSortEntry>& entries, std::vector<DrawSortEntry>& scratch) {
+    scratch.resize(entries.size());
+
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        std::array<uint32_t, 256> counts{};
+        for (const auto& entry : entries) {
+            counts[entry.key >> shift & 0xFF]++;
+        }
+        if (std::ranges::find(counts, static_cast<uint32_t>(entries.size())) != counts.end()) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (auto& count : counts) {
+            const uint32_t bucketSize = count;
+            count = offset;
+            offset += bucketSize;
+        }
+
+        for (const auto& entry : entries) {
+            scratch[counts[entry.key >> shift & 0xFF]++] = entry;
+        }
+        entries.swap(scratch);
+    }
+}
+}
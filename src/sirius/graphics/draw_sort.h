@@ -0,0 +1,72 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace sirius {
+// Key layout from most to least significant: pipeline (12 bits), material set (20 bits), index buffer (16 bits), view depth (16 bits).
+// Sorting by it groups draws that share state, front to back inside each group
+struct DrawSortEntry {
+    uint64_t key;
+    uint32_t index;
+};
+
+// Everything a draw renders apart from its transform. Sorted draws with equal keys are merged into one instanced draw
+struct InstanceKey {
+    const void* material;
+    const void* indexBuffer;
+    uint64_t vertexBuffer;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t vertexOffset;
+
+    bool operator==(const InstanceKey&) const = default;
+};
+
+struct InstanceKeyHash {
+    size_t operator()(const InstanceKey& key) const;
+};
+
+// Instanced draw of sorted draws that share an InstanceKey, their transforms are contiguous in the frame's instance buffer
+struct DrawBatch {
+    // Any object of the batch, the others only differ in their transform
+    uint32_t object;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+};
+
+// Widths of the handle fields of the sort key
+constexpr uint32_t kPipelineIdBits = 12;
+constexpr uint32_t kMaterialIdBits = 20;
+constexpr uint32_t kIndexBufferIdBits = 16;
+static_assert(kPipelineIdBits + kMaterialIdBits + kIndexBufferIdBits == 48, "the view depth takes the lowest 16 bits");
+
+// Hands out small ids for the Vulkan handles of one key field so they fit into it. Ids of released handles are handed out again
+class SortKeyIds {
+public:
+    explicit SortKeyIds(uint32_t bits) : capacity_(1u << bits) {}
+
+    // Once the field is full every new handle gets its last id. Sharing an id only costs sort quality, draws compare their actual state
+    uint32_t Get(const void* handle);
+
+    // For handles that are destroyed, their id may go to the next new one
+    void Release(const void* handle);
+
+private:
+    uint32_t capacity_;
+    uint32_t nextId_ = 0;
+    std::unordered_map<const void*, uint32_t> ids_;
+    std::vector<uint32_t> freeIds_;
+};
+
+uint64_t BuildSortKey(uint32_t pipelineId, uint32_t materialId, uint32_t indexBufferId, float viewDepth);
+
+// LSD radix sort on the key, 8 bits per pass. Passes where every key has the same byte are skipped
+void RadixSort(std::vector<DrawSortEntry>& entries, std::vector<DrawSortEntry>& scratch);
+}
@@ -0,0 +1,67 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "frame_allocator.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include <fmt/core.h>
+
+namespace sirius {
+void FrameUniformAllocator::Init(VmaAllocator allocator, VkDeviceSize capacity, VkDeviceSize alignment) {
+    allocator_ = allocator;
+    alignment_ = alignment;
+    capacity_ = capacity;
+    head_ = 0;
+    buffer_ = CreateRingBuffer(capacity_);
+}
+
+void FrameUniformAllocator::Reset() {
+    for (const auto& buffer : retiredBuffers_) {
+        vmaDestroyBuffer(allocator_, buffer.buffer, buffer.allocation);
+    }
+    retiredBuffers_.clear();
+    head_ = 0;
+}
+
+void FrameUniformAllocator::Destroy() {
+    Reset();
+    vmaDestroyBuffer(allocator_, buffer_.buffer, buffer_.allocation);
+    buffer_ = {};
+}
+
+FrameUniformAllocator::Allocation FrameUniformAllocator::Allocate(VkDeviceSize size) {
+    // alignment is a power of two, guaranteed for minUniformBufferOffsetAlignment
+    const VkDeviceSize offset = (head_ + alignment_ - 1) & ~(alignment_ - 1);
+
+    if (offset + size > capacity_) {
+        // Out of space: keep the old buffer alive until the frame is done and continue in a bigger one
+        retiredBuffers_.push_back(buffer_);
+        capacity_ = std::max(capacity_, size) * 2;
+        fmt::println("Frame uniform allocator grew to {} bytes", capacity_);
+        buffer_ = CreateRingBuffer(capacity_);
+        head_ = 0;
+        return Allocate(size);
+    }
+
+    head_ = offset + size;
+    return {buffer_.buffer, offset, size, static_cast<std::byte*>(buffer_.info.pMappedData) + offset};
+}
+
+AllocatedBuffer FrameUniformAllocator::CreateRingBuffer(VkDeviceSize capacity) const {
+    VkBufferCreateInfo bufferInfo = {.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    bufferInfo.size = capacity;
+    // Shaders read per-frame data such as cull views and instance transforms through a buffer address
+    bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+    VmaAllocationCreateInfo allocationInfo = {};
+    allocationInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+    allocationInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    AllocatedBuffer newBuffer{};
+    VK_CHECK(vmaCreateBuffer(allocator_, &bufferInfo, &allocationInfo, &newBuffer.buffer, &newBuffer.allocation, &newBuffer.info));
+    return newBuffer;
+}
+}
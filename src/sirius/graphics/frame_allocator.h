@@ -0,0 +1,52 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <vector>
+
+#include "types.h"
+
+namespace sirius {
+// Persistently mapped linear allocator for per-frame constants. Every frame in flight owns one and resets it once its fence has signaled,
+// so handing out memory is a pointer bump instead of a VMA allocation
+class FrameUniformAllocator {
+public:
+    struct Allocation {
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        void* data;
+    };
+
+    void Init(VmaAllocator allocator, VkDeviceSize capacity, VkDeviceSize alignment);
+
+    // Only call after the frame fence has signaled
+    void Reset();
+
+    void Destroy();
+
+    Allocation Allocate(VkDeviceSize size);
+
+    template<typename T>
+    Allocation Push(const T& value) {
+        Allocation allocation = Allocate(sizeof(T));
+        *static_cast<T*>(allocation.data) = value;
+        return allocation;
+    }
+
+    [[nodiscard]] VkDeviceSize GetUsed() const { return head_; }
+
+private:
+    AllocatedBuffer CreateRingBuffer(VkDeviceSize capacity) const;
+
+    VmaAllocator allocator_ = VK_NULL_HANDLE;
+    VkDeviceSize alignment_ = 256;
+    VkDeviceSize capacity_ = 0;
+    VkDeviceSize head_ = 0;
+    AllocatedBuffer buffer_{};
+    // Buffers that were outgrown this frame, the GPU may still read them until the next Reset
+    std::vector<AllocatedBuffer> retiredBuffers_;
+};
+}
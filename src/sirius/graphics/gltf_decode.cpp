@@ -0,0 +1,412 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "gltf_decode.h"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <glm/glm.hpp>
+#include <ext/matrix_transform.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <gtx/quaternion.hpp>
+
+#include "core/jobs.h"
+#include "core/profiler.h"
+#include "fastgltf/core.hpp"
+#include "fastgltf/tools.hpp"
+#include "fastgltf/glm_element_traits.hpp"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace sirius {
+namespace {
+Bounds ComputeBounds(std::span<const Vertex> vertices) {
+    if (vertices.empty()) {
+        return {};
+    }
+
+    glm::vec3 min = vertices[0].position;
+    glm::vec3 max = vertices[0].position;
+    for (const Vertex& vertex : vertices) {
+        min = glm::min(min, vertex.position);
+        max = glm::max(max, vertex.position);
+    }
+
+    Bounds bounds{};
+    bounds.origin = (max + min) * 0.5f;
+    bounds.extents = (max - min) * 0.5f;
+    // Tighter than the sphere around the box
+    for (const Vertex& vertex : vertices) {
+        bounds.sphereRadius = std::max(bounds.sphereRadius, glm::distance(bounds.origin, vertex.position));
+    }
+    return bounds;
+}
+
+Bounds ComputeMeshBounds(std::span<const PackageSurface> surfaces) {
+    if (surfaces.empty()) {
+        return {};
+    }
+
+    Bounds bounds = surfaces[0].bounds;
+    for (const PackageSurface& surface : surfaces.subspan(1)) {
+        bounds = MergeBounds(bounds, surface.bounds);
+    }
+    return bounds;
+}
+
+glm::mat4 ConvertTransform(const fastgltf::Node& node) {
+    glm::mat4 localTransform{};
+    std::visit(
+        fastgltf::visitor{
+            [&](const fastgltf::math::fmat4x4& matrix) {
+                memcpy(&localTransform, matrix.data(), sizeof(matrix));
+            },
+            [&](fastgltf::TRS transform) {
+                const glm::vec3 tl(transform.translation[0], transform.translation[1], transform.translation[2]);
+                const glm::quat rot(transform.rotation[3], transform.rotation[0], transform.rotation[1], transform.rotation[2]);
+                const glm::vec3 sc(transform.scale[0], transform.scale[1], transform.scale[2]);
+
+                const glm::mat4 tm = glm::translate(glm::mat4(1.f), tl);
+                const glm::mat4 rm = glm::toMat4(rot);
+                const glm::mat4 sm = glm::scale(glm::mat4(1.f), sc);
+
+                localTransform = tm * rm * sm;
+            }
+        }, node.transform);
+    return localTransform;
+}
+
+// EXT_mesh_gpu_instancing, in the node's space. Attributes that are missing keep their identity value
+std::vector<glm::mat4> ReadInstanceTransforms(const fastgltf::Asset& gltf, const fastgltf::Node& node) {
+    size_t count = 0;
+    for (const auto& attribute : node.instancingAttributes) {
+        count = std::max(count, gltf.accessors[attribute.accessorIndex].count);
+    }
+
+    std::vector<glm::vec3> translations(count, glm::vec3(0.0f));
+    std::vector<glm::quat> rotations(count, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+    std::vector<glm::vec3> scales(count, glm::vec3(1.0f));
+    if (auto translation = node.findInstancingAttribute("TRANSLATION"); translation != node.instancingAttributes.end()) {
+        fastgltf::copyFromAccessor<glm::vec3>(gltf, gltf.accessors[translation->accessorIndex], translations.data());
+    }
+    // Rotations may be normalized integers, the iteration converts them
+    if (auto rotation = node.findInstancingAttribute("ROTATION"); rotation != node.instancingAttributes.end()) {
+        fastgltf::iterateAccessorWithIndex<glm::vec4>(gltf, gltf.accessors[rotation->accessorIndex], [&](const glm::vec4 v, const size_t index) {
+            rotations[index] = glm::quat(v.w, v.x, v.y, v.z);
+        });
+    }
+    if (auto scale = node.findInstancingAttribute("SCALE"); scale != node.instancingAttributes.end()) {
+        fastgltf::copyFromAccessor<glm::vec3>(gltf, gltf.accessors[scale->accessorIndex], scales.data());
+    }
+
+    std::vector<glm::mat4> transforms(count);
+    for (size_t i = 0; i < count; i++) {
+        transforms[i] = glm::translate(glm::mat4(1.0f), translations[i]) * glm::toMat4(rotations[i]) * glm::scale(glm::mat4(1.0f), scales[i]);
+    }
+    return transforms;
+}
+}
+
+void StbiDeleter::operator()(unsigned char* pixels) const {
+    stbi_image_free(pixels);
+}
+
+std::optional<fastgltf::Asset> ParseGltf(const std::filesystem::path& path) {
+    // KTX2 images are only referenced through the extension
+    fastgltf::Parser parser(fastgltf::Extensions::KHR_texture_basisu | fastgltf::Extensions::EXT_mesh_gpu_instancing);
+
+    constexpr auto gltfOptions = fastgltf::Options::DontRequireValidAssetMember | fastgltf::Options::AllowDouble | fastgltf::Options::LoadGLBBuffers | fastgltf::Options::LoadExternalBuffers;
+
+    fastgltf::Expected<fastgltf::GltfDataBuffer> result = fastgltf::GltfDataBuffer::FromPath(path);
+    if (!result) {
+        throw std::runtime_error("Failed to load glTF: " + std::to_string(static_cast<int>(result.error())));
+    }
+    auto data = std::move(result.get());
+
+    auto type = fastgltf::determineGltfFileType(data);
+    if (type == fastgltf::GltfType::glTF) {
+        auto load = parser.loadGltfJson(data, path.parent_path(), gltfOptions);
+        if (load) {
+            return std::move(load.get());
+        }
+        std::cerr << "Failed to load glTF: " << fastgltf::to_underlying(load.error()) << std::endl;
+    } else if (type == fastgltf::GltfType::GLB) {
+        auto load = parser.loadGltfBinary(data, path.parent_path(), gltfOptions);
+        if (load) {
+            return std::move(load.get());
+        }
+        std::cerr << "Failed to load glb: " << fastgltf::to_underlying(load.error()) << std::endl;
+    } else {
+        std::cerr << "Failed to determine glTF container" << std::endl;
+    }
+    return std::nullopt;
+}
+
+DecodedMesh DecodeMesh(const fastgltf::Asset& gltf, const fastgltf::Mesh& mesh, bool compactVertices) {
+    SRS_PROFILE_SCOPE("DecodeMesh");
+    DecodedMesh decoded;
+
+    // Size the buffers once, every attribute is then written straight to its place
+    size_t indexCount = 0;
+    size_t vertexCount = 0;
+    for (const fastgltf::Primitive& primitive : mesh.primitives) {
+        indexCount += gltf.accessors[primitive.indicesAccessor.value()].count;
+        vertexCount += gltf.accessors[primitive.findAttribute("POSITION")->accessorIndex].count;
+    }
+    decoded.indices.resize(indexCount);
+    decoded.vertices.resize(vertexCount, Vertex{.normal = {1, 0, 0}, .color = glm::vec4{1.f}});
+
+    size_t firstIndex = 0;
+    size_t firstVertex = 0;
+    for (const fastgltf::Primitive& primitive : mesh.primitives) {
+        const fastgltf::Accessor& indexAccessor = gltf.accessors[primitive.indicesAccessor.value()];
+        const fastgltf::Accessor& positionAccessor = gltf.accessors[primitive.findAttribute("POSITION")->accessorIndex];
+        Vertex* vertices = &decoded.vertices[firstVertex];
+
+        PackageSurface surface{};
+        surface.startIndex = static_cast<uint32_t>(firstIndex);
+        surface.count = static_cast<uint32_t>(indexAccessor.count);
+        surface.material = primitive.materialIndex.has_value() ? static_cast<uint32_t>(primitive.materialIndex.value()) : kPackageNone;
+
+        // Indices of a mesh are relative to its first vertex
+        fastgltf::copyFromAccessor<std::uint32_t>(gltf, indexAccessor, &decoded.indices[firstIndex]);
+        for (size_t i = firstIndex; i < firstIndex + indexAccessor.count; i++) {
+            decoded.indices[i] += static_cast<uint32_t>(firstVertex);
+        }
+
+        // Strided copies write the attributes into the interleaved vertices without a callback per element
+        fastgltf::copyFromAccessor<glm::vec3, sizeof(Vertex)>(gltf, positionAccessor, &vertices->position);
+
+        if (auto normals = primitive.findAttribute("NORMAL"); normals != primitive.attributes.end()) {
+            fastgltf::copyFromAccessor<glm::vec3, sizeof(Vertex)>(gltf, gltf.accessors[normals->accessorIndex], &vertices->normal);
+        }
+
+        // The two UV components are split around the normal
+        if (auto uv = primitive.findAttribute("TEXCOORD_0"); uv != primitive.attributes.end()) {
+            fastgltf::iterateAccessorWithIndex<glm::vec2>(gltf, gltf.accessors[uv->accessorIndex], [&](const glm::vec2 v, const size_t index) {
+                vertices[index].uvX = v.x;
+                vertices[index].uvY = v.y;
+            });
+        }
+
+        if (auto colors = primitive.findAttribute("COLOR_0"); colors != primitive.attributes.end()) {
+            fastgltf::copyFromAccessor<glm::vec4, sizeof(Vertex)>(gltf, gltf.accessors[colors->accessorIndex], &vertices->color);
+        }
+
+        surface.bounds = ComputeBounds(std::span(decoded.vertices).subspan(firstVertex, positionAccessor.count));
+        decoded.surfaces.push_back(surface);
+
+        firstIndex += indexAccessor.count;
+        firstVertex += positionAccessor.count;
+    }
+
+    decoded.bounds = ComputeMeshBounds(decoded.surfaces);
+    decoded.optimization = OptimizeMesh(decoded.indices, decoded.vertices, decoded.surfaces);
+    decoded.optimization.coarsestLodTriangles = BuildLods(decoded.indices, decoded.vertices, decoded.surfaces);
+    decoded.meshlets = BuildMeshlets(decoded.indices, decoded.vertices, decoded.surfaces);
+    decoded.packedVertices = PackVertices(decoded.vertices, compactVertices);
+    decoded.packedIndices = PackIndices(decoded.indices, decoded.vertices.size());
+    return decoded;
+}
+
+std::vector<DecodedMesh> DecodeMeshes(const fastgltf::Asset& gltf, bool compactVertices) {
+    std::vector<DecodedMesh> decoded(gltf.meshes.size());
+    JobSystem::ParallelFor(static_cast<uint32_t>(gltf.meshes.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            decoded[i] = DecodeMesh(gltf, gltf.meshes[i], compactVertices);
+        }
+    });
+    return decoded;
+}
+
+MeshOptimizationStats GetOptimizationStats(std::span<const DecodedMesh> meshes) {
+    MeshOptimizationStats stats{};
+    for (const DecodedMesh& mesh : meshes) {
+        stats.Add(mesh.optimization);
+    }
+    return stats;
+}
+
+EncodedImage ReadImage(const fastgltf::Asset& gltf, const fastgltf::Image& image, const std::filesystem::path& directory) {
+    return std::visit(
+        fastgltf::visitor{
+            [](const auto&) {
+                return EncodedImage{};
+            },
+            [&](const fastgltf::sources::URI& uri) {
+                // Offsets into files are not used by the loaders we care about
+                assert(uri.fileByteOffset == 0);
+                assert(uri.uri.isLocalPath());
+
+                EncodedImage encoded;
+                std::ifstream file(directory / uri.uri.fspath(), std::ios::ate | std::ios::binary);
+                if (!file.is_open()) {
+                    return encoded;
+                }
+                encoded.fileBytes.resize(static_cast<size_t>(file.tellg()));
+                file.seekg(0);
+                file.read(reinterpret_cast<char*>(encoded.fileBytes.data()), static_cast<std::streamsize>(encoded.fileBytes.size()));
+                encoded.bytes = encoded.fileBytes;
+                return encoded;
+            },
+            [](const fastgltf::sources::Array& array) {
+                return EncodedImage{std::span(array.bytes.data(), array.bytes.size()), {}};
+            },
+            [](const fastgltf::sources::Vector& vector) {
+                return EncodedImage{std::span(vector.bytes.data(), vector.bytes.size()), {}};
+            },
+            [&](const fastgltf::sources::BufferView& view) {
+                const fastgltf::BufferView& bufferView = gltf.bufferViews[view.bufferViewIndex];
+                const fastgltf::Buffer& buffer = gltf.buffers[bufferView.bufferIndex];
+
+                // The load options turn every buffer into an array
+                return std::visit(
+                    fastgltf::visitor{
+                        [](const auto&) {
+                            return EncodedImage{};
+                        },
+                        [&](const fastgltf::sources::Array& array) {
+                            return EncodedImage{std::span(array.bytes.data() + bufferView.byteOffset, bufferView.byteLength), {}};
+                        }
+                    }, buffer.data);
+            },
+        }, image.data);
+}
+
+Rgba8Image DecodeRgba8(std::span<const std::byte> bytes) {
+    SRS_PROFILE_SCOPE("DecodeRgba8");
+    int width, height, channels;
+    stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(bytes.data()), static_cast<int>(bytes.size()), &width, &height, &channels, 4);
+    if (pixels == nullptr) {
+        return {};
+    }
+    return {std::unique_ptr<unsigned char, StbiDeleter>(pixels), VkExtent3D{static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1}};
+}
+
+std::vector<PackageSampler> ConvertSamplers(const fastgltf::Asset& gltf) {
+    std::vector<PackageSampler> samplers;
+    samplers.reserve(gltf.samplers.size());
+    for (const fastgltf::Sampler& sampler : gltf.samplers) {
+        PackageSampler converted{};
+        converted.magFilter = ExtractFilter(sampler.magFilter.value_or(fastgltf::Filter::Nearest));
+        converted.minFilter = ExtractFilter(sampler.minFilter.value_or(fastgltf::Filter::Nearest));
+        converted.mipmapMode = ExtractMipMapMode(sampler.minFilter.value_or(fastgltf::Filter::Nearest));
+        samplers.push_back(converted);
+    }
+    return samplers;
+}
+
+PackageMaterial ConvertMaterial(const fastgltf::Asset& gltf, const fastgltf::Material& material) {
+    PackageMaterial converted{};
+    converted.colorFactors.x = material.pbrData.baseColorFactor[0];
+    converted.colorFactors.y = material.pbrData.baseColorFactor[1];
+    converted.colorFactors.z = material.pbrData.baseColorFactor[2];
+    converted.colorFactors.w = material.pbrData.baseColorFactor[3];
+
+    converted.metalRoughFactors.x = material.pbrData.metallicFactor;
+    converted.metalRoughFactors.y = material.pbrData.roughnessFactor;
+
+    converted.passType = material.alphaMode == fastgltf::AlphaMode::Blend ? MaterialPass::kTransparent : MaterialPass::kMainColor;
+    converted.doubleSided = material.doubleSided;
+
+    converted.colorImage = kPackageNone;
+    converted.colorSampler = kPackageNone;
+    if (material.pbrData.baseColorTexture.has_value()) {
+        const fastgltf::Texture& texture = gltf.textures[material.pbrData.baseColorTexture.value().textureIndex];
+
+        // The KTX2 version is preferred, the plain image is the fallback for loaders without the extension
+        converted.colorImage = static_cast<uint32_t>(texture.basisuImageIndex.has_value() ? texture.basisuImageIndex.value() : texture.imageIndex.value());
+        // Textures without a sampler repeat and filter linearly
+        if (texture.samplerIndex.has_value()) {
+            converted.colorSampler = static_cast<uint32_t>(texture.samplerIndex.value());
+        }
+    }
+    return converted;
+}
+
+std::vector<PackageNode> ConvertNodes(const fastgltf::Asset& gltf, std::vector<uint32_t>& gltfIndices) {
+    std::vector<uint32_t> parents(gltf.nodes.size(), kPackageNone);
+    for (size_t i = 0; i < gltf.nodes.size(); i++) {
+        for (const size_t child : gltf.nodes[i].children) {
+            parents[child] = static_cast<uint32_t>(i);
+        }
+    }
+
+    // Breadth first from the roots, a node is only added after its parent
+    gltfIndices.clear();
+    for (size_t i = 0; i < gltf.nodes.size(); i++) {
+        if (parents[i] == kPackageNone) {
+            gltfIndices.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    for (size_t i = 0; i < gltfIndices.size(); i++) {
+        for (const size_t child : gltf.nodes[gltfIndices[i]].children) {
+            gltfIndices.push_back(static_cast<uint32_t>(child));
+        }
+    }
+
+    std::vector<uint32_t> packageIndices(gltf.nodes.size(), kPackageNone);
+    std::vector<PackageNode> nodes(gltfIndices.size());
+    for (size_t i = 0; i < gltfIndices.size(); i++) {
+        const fastgltf::Node& node = gltf.nodes[gltfIndices[i]];
+        packageIndices[gltfIndices[i]] = static_cast<uint32_t>(i);
+
+        nodes[i].parent = parents[gltfIndices[i]] == kPackageNone ? kPackageNone : packageIndices[parents[gltfIndices[i]]];
+        nodes[i].mesh = node.meshIndex.has_value() ? static_cast<uint32_t>(node.meshIndex.value()) : kPackageNone;
+        nodes[i].localTransform = ConvertTransform(node);
+    }
+
+    // Every GPU instance becomes a child that draws the mesh, the node itself draws nothing. The renderer merges them back into instanced draws
+    const size_t gltfNodeCount = gltfIndices.size();
+    for (size_t i = 0; i < gltfNodeCount; i++) {
+        const fastgltf::Node& node = gltf.nodes[gltfIndices[i]];
+        if (node.instancingAttributes.empty() || !node.meshIndex.has_value()) {
+            continue;
+        }
+
+        for (const glm::mat4& transform : ReadInstanceTransforms(gltf, node)) {
+            PackageNode instance{};
+            instance.parent = static_cast<uint32_t>(i);
+            instance.mesh = nodes[i].mesh;
+            instance.localTransform = transform;
+            nodes.push_back(instance);
+            gltfIndices.push_back(kPackageNone);
+        }
+        nodes[i].mesh = kPackageNone;
+    }
+    return nodes;
+}
+
+VkFilter ExtractFilter(fastgltf::Filter filter) {
+    switch (filter) {
+        // nearest samplers
+        case fastgltf::Filter::Nearest:
+        case fastgltf::Filter::NearestMipMapNearest:
+        case fastgltf::Filter::NearestMipMapLinear:
+            return VK_FILTER_NEAREST;
+
+        // linear samplers
+        case fastgltf::Filter::Linear:
+        case fastgltf::Filter::LinearMipMapNearest:
+        case fastgltf::Filter::LinearMipMapLinear:
+        default:
+            return VK_FILTER_LINEAR;
+    }
+}
+
+VkSamplerMipmapMode ExtractMipMapMode(fastgltf::Filter filter) {
+    switch (filter) {
+        case fastgltf::Filter::NearestMipMapNearest:
+        case fastgltf::Filter::LinearMipMapNearest:
+            return VK_SAMPLER_MIPMAP_MODE_NEAREST;
+
+        case fastgltf::Filter::NearestMipMapLinear:
+        case fastgltf::Filter::LinearMipMapLinear:
+        default:
+            return VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    }
+}
+}
@@ -0,0 +1,79 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "mesh_optimize.h"
+#include "scene_package.h"
+#include "types.h"
+#include "vertex_compression.h"
+#include "fastgltf/types.hpp"
+
+namespace sirius {
+// CPU side of glTF loading, shared by the runtime loader and sirius-cook. Needs no device, everything here may run on worker threads
+
+// CPU side geometry of one mesh
+struct DecodedMesh {
+    std::vector<uint32_t> indices;
+    std::vector<Vertex> vertices;
+    std::vector<PackageSurface> surfaces;
+    Bounds bounds;
+    std::vector<Meshlet> meshlets;
+    MeshOptimizationStats optimization;
+    // The final vertices and indices in the layout that is uploaded or cooked
+    PackedVertices packedVertices;
+    PackedIndices packedIndices;
+};
+
+struct StbiDeleter {
+    void operator()(unsigned char* pixels) const;
+};
+
+// RGBA8 pixels of the first level, empty if the image could not be decoded
+struct Rgba8Image {
+    std::unique_ptr<unsigned char, StbiDeleter> pixels;
+    VkExtent3D extent;
+};
+
+// Encoded bytes of an image, either borrowed from the asset or read from a file next to it
+struct EncodedImage {
+    std::span<const std::byte> bytes;
+    std::vector<std::byte> fileBytes;
+};
+
+std::optional<fastgltf::Asset> ParseGltf(const std::filesystem::path& path);
+
+// Only reads the asset, so meshes can be decoded concurrently. The result is already run through OptimizeMesh, BuildLods and BuildMeshlets,
+// then packed with PackVertices and PackIndices
+DecodedMesh DecodeMesh(const fastgltf::Asset& gltf, const fastgltf::Mesh& mesh, bool compactVertices);
+
+// Decodes every mesh of the asset on the job system
+std::vector<DecodedMesh> DecodeMeshes(const fastgltf::Asset& gltf, bool compactVertices);
+
+// Sums the optimization statistics of every mesh
+MeshOptimizationStats GetOptimizationStats(std::span<const DecodedMesh> meshes);
+
+// Handles external files relative to the glTF, data URIs and images inside a buffer view. Empty if the source is not supported
+EncodedImage ReadImage(const fastgltf::Asset& gltf, const fastgltf::Image& image, const std::filesystem::path& directory);
+
+Rgba8Image DecodeRgba8(std::span<const std::byte> bytes);
+
+std::vector<PackageSampler> ConvertSamplers(const fastgltf::Asset& gltf);
+
+// Everything but the name
+PackageMaterial ConvertMaterial(const fastgltf::Asset& gltf, const fastgltf::Material& material);
+
+// Sorts the nodes so that parents come before their children. gltfIndices receives the glTF node of each package node, names are left empty.
+// Nodes with EXT_mesh_gpu_instancing get one child per instance behind all glTF nodes, their glTF node is kPackageNone
+std::vector<PackageNode> ConvertNodes(const fastgltf::Asset& gltf, std::vector<uint32_t>& gltfIndices);
+
+VkFilter ExtractFilter(fastgltf::Filter filter);
+VkSamplerMipmapMode ExtractMipMapMode(fastgltf::Filter filter);
+}
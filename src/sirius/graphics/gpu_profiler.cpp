@@ -0,0 +1,129 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "gpu_profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "types.h"
+#include <fmt/core.h>
+
+namespace sirius {
+void GpuProfiler::Init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t graphicsQueueFamily, uint32_t frameCount) {
+    device_ = device;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    timestampPeriod_ = properties.limits.timestampPeriod;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    const uint32_t validBits = queueFamilies[graphicsQueueFamily].timestampValidBits;
+    supported_ = validBits > 0 && timestampPeriod_ > 0.0;
+    if (!supported_) {
+        fmt::println("GPU profiler: timestamps are not supported on the graphics queue");
+        return;
+    }
+    timestampMask_ = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkQueryPoolCreateInfo queryPoolInfo = {.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = kMaxScopes * 2;
+
+    frames_.resize(frameCount);
+    for (auto& frame : frames_) {
+        VK_CHECK(vkCreateQueryPool(device_, &queryPoolInfo, nullptr, &frame.pool));
+        frame.scopeNames.reserve(kMaxScopes);
+    }
+}
+
+void GpuProfiler::Destroy() {
+    for (const auto& frame : frames_) {
+        vkDestroyQueryPool(device_, frame.pool, nullptr);
+    }
+    frames_.clear();
+}
+
+bool GpuProfiler::Resolve(uint32_t frameIndex) {
+    if (!supported_) {
+        return false;
+    }
+
+    FrameQueries& frame = frames_[frameIndex];
+    if (frame.scopeNames.empty()) {
+        return false;
+    }
+
+    std::array<uint64_t, kMaxScopes * 2> timestamps{};
+    const auto queryCount = static_cast<uint32_t>(frame.scopeNames.size() * 2);
+
+    // No wait flag, a frame that was recorded but never submitted reports VK_NOT_READY and is skipped
+    const VkResult result = vkGetQueryPoolResults(device_, frame.pool, 0, queryCount, queryCount * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) {
+        frame.scopeNames.clear();
+        return false;
+    }
+
+    results_.clear();
+    for (size_t i = 0; i < frame.scopeNames.size(); i++) {
+        const uint64_t ticks = (timestamps[i * 2 + 1] - timestamps[i * 2]) & timestampMask_;
+        const double milliseconds = static_cast<double>(ticks) * timestampPeriod_ / 1000000.0;
+
+        results_.push_back({frame.scopeNames[i], milliseconds});
+        RecordHistory(frame.scopeNames[i], milliseconds);
+    }
+
+    frame.scopeNames.clear();
+    return true;
+}
+
+void GpuProfiler::BeginFrame(VkCommandBuffer cmd, uint32_t frameIndex) {
+    currentFrame_ = frameIndex;
+    if (!supported_) {
+        return;
+    }
+
+    frames_[frameIndex].scopeNames.clear();
+    vkCmdResetQueryPool(cmd, frames_[frameIndex].pool, 0, kMaxScopes * 2);
+}
+
+uint32_t GpuProfiler::BeginScope(VkCommandBuffer cmd, const char* name) {
+    if (!supported_) {
+        return 0;
+    }
+
+    FrameQueries& frame = frames_[currentFrame_];
+    assert(frame.scopeNames.size() < kMaxScopes && "Too many GPU profiler scopes in one frame");
+
+    const auto scope = static_cast<uint32_t>(frame.scopeNames.size());
+    frame.scopeNames.push_back(name);
+
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, frame.pool, scope * 2);
+    return scope;
+}
+
+void GpuProfiler::EndScope(VkCommandBuffer cmd, uint32_t scope) {
+    if (!supported_) {
+        return;
+    }
+
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frames_[currentFrame_].pool, scope * 2 + 1);
+}
+
+void GpuProfiler::RecordHistory(const char* name, double milliseconds) {
+    auto it = std::ranges::find_if(history_, [name](const PassHistory& history) { return std::strcmp(history.name, name) == 0; });
+    if (it == history_.end()) {
+        history_.push_back({name, {}, 0});
+        it = history_.end() - 1;
+    }
+
+    it->milliseconds[it->offset] = static_cast<float>(milliseconds);
+    it->offset = (it->offset + 1) % kHistoryLength;
+}
+}
@@ -0,0 +1,71 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <array>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+namespace sirius {
+struct GpuPassTiming {
+    const char* name;
+    double milliseconds;
+};
+
+// Timestamp queries around the passes of a frame. Every frame in flight has its own query pool, which is read back without waiting
+// once that frame slot comes around again, so results lag kFrameOverlap frames behind
+class GpuProfiler {
+public:
+    static constexpr uint32_t kMaxScopes = 32;
+    static constexpr size_t kHistoryLength = 240;
+
+    struct PassHistory {
+        const char* name;
+        std::array<float, kHistoryLength> milliseconds;
+        size_t offset;
+    };
+
+    void Init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t graphicsQueueFamily, uint32_t frameCount);
+
+    void Destroy();
+
+    // Reads the results this frame slot recorded last time. Only call after the frame fence has signaled
+    bool Resolve(uint32_t frameIndex);
+
+    // Resets the queries of the frame slot, has to be recorded before the first scope of the frame
+    void BeginFrame(VkCommandBuffer cmd, uint32_t frameIndex);
+
+    // Names have to outlive the profiler, string literals are expected
+    uint32_t BeginScope(VkCommandBuffer cmd, const char* name);
+
+    void EndScope(VkCommandBuffer cmd, uint32_t scope);
+
+    // Timings of the most recently resolved frame, in the order the scopes were opened
+    [[nodiscard]] std::span<const GpuPassTiming> GetResults() const { return results_; }
+
+    [[nodiscard]] std::span<const PassHistory> GetHistory() const { return history_; }
+
+    [[nodiscard]] bool IsSupported() const { return supported_; }
+
+private:
+    struct FrameQueries {
+        VkQueryPool pool;
+        std::vector<const char*> scopeNames;
+    };
+
+    void RecordHistory(const char* name, double milliseconds);
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    bool supported_ = false;
+    double timestampPeriod_ = 1.0;
+    uint64_t timestampMask_ = ~0ull;
+
+    uint32_t currentFrame_ = 0;
+    std::vector<FrameQueries> frames_;
+    std::vector<GpuPassTiming> results_;
+    std::vector<PassHistory> history_;
+};
+}
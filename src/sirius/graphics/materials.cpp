@@ -10,7 +10,8 @@
 
 namespace sirius {
 
-void GltfMetallicRoughness::BuildPipelines(VkDevice device, VkFormat drawImageFormat, VkFormat depthImageFormat, VkDescriptorSetLayout sceneDataDescriptorLayout) {
+void GltfMetallicRoughness::BuildPipelines(VkDevice device, PipelineCache& pipelineCache, VkFormat drawImageFormat, VkFormat depthImageFormat,
+                                           VkDescriptorSetLayout sceneDataDescriptorLayout) {
     VkShaderModule fragShader;
     if (!LoadShaderModule("../../src/sirius/shaders/mesh.frag.spv", device, &fragShader)) {
         fmt::println("Error while building frag shader module");
@@ -19,6 +20,10 @@ void GltfMetallicRoughness::BuildPipelines(VkDevice device, VkFormat drawImageFo
     if (!LoadShaderModule("../../src/sirius/shaders/mesh.vert.spv", device, &vertShader)) {
         fmt::println("Error while building vert shader module");
     }
+    VkShaderModule indirectVertShader;
+    if (!LoadShaderModule("../../src/sirius/shaders/mesh_indirect.vert.spv", device, &indirectVertShader)) {
+        fmt::println("Error while building indirect vert shader module");
+    }
 
     VkPushConstantRange matrixRange{};
     matrixRange.offset = 0;
@@ -58,16 +63,22 @@ void GltfMetallicRoughness::BuildPipelines(VkDevice device, VkFormat drawImageFo
     pipelineBuilder.SetDepthFormat(depthImageFormat);
     pipelineBuilder.pipelineLayout_ = newLayout;
 
-    opaquePipeline_.pipeline = pipelineBuilder.BuildPipeline(device);
+    opaquePipeline_.pipeline = pipelineBuilder.BuildPipeline(pipelineCache);
+    pipelineBuilder.SetShaders(indirectVertShader, fragShader);
+    opaquePipeline_.indirectPipeline = pipelineBuilder.BuildPipeline(pipelineCache);
 
     // Transparent variant
+    pipelineBuilder.SetShaders(vertShader, fragShader);
     pipelineBuilder.EnableBlendingAdditive();
     pipelineBuilder.EnableDepthTest(false, VK_COMPARE_OP_GREATER_OR_EQUAL);
 
-    transparentPipeline_.pipeline = pipelineBuilder.BuildPipeline(device);
+    transparentPipeline_.pipeline = pipelineBuilder.BuildPipeline(pipelineCache);
+    pipelineBuilder.SetShaders(indirectVertShader, fragShader);
+    transparentPipeline_.indirectPipeline = pipelineBuilder.BuildPipeline(pipelineCache);
 
     vkDestroyShaderModule(device, fragShader, nullptr);
     vkDestroyShaderModule(device, vertShader, nullptr);
+    vkDestroyShaderModule(device, indirectVertShader, nullptr);
 
 }
 
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "descriptors.h"
+#include "pipeline_cache.h"
 #include "types.h"
 
 namespace sirius {
@@ -33,7 +34,7 @@ public:
 
     DescriptorWriter writer_;
 
-    void BuildPipelines(VkDevice device, VkFormat drawImageFormat, VkFormat depthImageFormat, VkDescriptorSetLayout sceneDataDescriptorLayout);
+    void BuildPipelines(VkDevice device, PipelineCache& pipelineCache, VkFormat drawImageFormat, VkFormat depthImageFormat, VkDescriptorSetLayout sceneDataDescriptorLayout);
     void ClearResources(VkDevice device);
     MaterialInstance WriteMaterial(VkDevice device, MaterialPass pass, const MaterialResources& resources, DescriptorAllocatorGrowable& descriptorAllocator);
 };
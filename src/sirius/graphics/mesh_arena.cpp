@@ -0,0 +1,136 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "mesh_arena.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <fmt/core.h>
+
+#include "vertex_compression.h"
+
+namespace sirius {
+void MeshArena::Init(VkDevice device, VmaAllocator allocator, std::vector<uint32_t> queueFamilies) {
+    device_ = device;
+    allocator_ = allocator;
+    queueFamilies_ = std::move(queueFamilies);
+
+    for (const VertexFormat format : {VertexFormat::kFull, VertexFormat::kCompact}) {
+        Pool& pool = vertexPools_[static_cast<size_t>(format)];
+        pool.elementSize = GetVertexStride(format);
+        pool.elementsPerPage = kVerticesPerPage;
+        pool.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    }
+
+    indexPool_.elementSize = sizeof(uint32_t);
+    indexPool_.elementsPerPage = kIndicesPerPage;
+    // The meshlet cull shader reads the indices through their address
+    indexPool_.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+    index16Pool_ = indexPool_;
+    index16Pool_.elementSize = sizeof(uint16_t);
+
+    meshletPool_.elementSize = sizeof(Meshlet);
+    meshletPool_.elementsPerPage = kMeshletsPerPage;
+    meshletPool_.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+}
+
+void MeshArena::Destroy() {
+    for (Pool* pool : {&vertexPools_[0], &vertexPools_[1], &indexPool_, &index16Pool_, &meshletPool_}) {
+        for (const Page& page : pool->pages) {
+            vmaClearVirtualBlock(page.block);
+            vmaDestroyVirtualBlock(page.block);
+            vmaDestroyBuffer(allocator_, page.buffer.buffer, page.buffer.allocation);
+        }
+        pool->pages.clear();
+    }
+}
+
+ArenaRange MeshArena::AllocateVertices(uint32_t count, VertexFormat format) {
+    return Allocate(vertexPools_[static_cast<size_t>(format)], count);
+}
+
+ArenaRange MeshArena::AllocateIndices(uint32_t count, VkIndexType type) {
+    return Allocate(type == VK_INDEX_TYPE_UINT16 ? index16Pool_ : indexPool_, count);
+}
+
+ArenaRange MeshArena::AllocateMeshlets(uint32_t count) {
+    return Allocate(meshletPool_, count);
+}
+
+void MeshArena::FreeVertices(const ArenaRange& range, VertexFormat format) {
+    Free(vertexPools_[static_cast<size_t>(format)], range);
+}
+
+void MeshArena::FreeIndices(const ArenaRange& range, VkIndexType type) {
+    Free(type == VK_INDEX_TYPE_UINT16 ? index16Pool_ : indexPool_, range);
+}
+
+void MeshArena::FreeMeshlets(const ArenaRange& range) {
+    Free(meshletPool_, range);
+}
+
+ArenaRange MeshArena::Allocate(Pool& pool, uint32_t count) const {
+    VmaVirtualAllocationCreateInfo allocationInfo{};
+    allocationInfo.size = std::max(count, 1u);
+    allocationInfo.alignment = 1;
+
+    ArenaRange range{};
+    range.count = count;
+
+    for (uint32_t i = 0; i < pool.pages.size(); i++) {
+        VkDeviceSize offset = 0;
+        if (vmaVirtualAllocate(pool.pages[i].block, &allocationInfo, &range.allocation, &offset) == VK_SUCCESS) {
+            range.page = i;
+            range.offset = static_cast<uint32_t>(offset);
+            return range;
+        }
+    }
+
+    // All pages are full, meshes bigger than a page get a page of their own size
+    pool.pages.push_back(CreatePage(pool, std::max(count, pool.elementsPerPage)));
+    range.page = static_cast<uint32_t>(pool.pages.size() - 1);
+
+    VkDeviceSize offset = 0;
+    VK_CHECK(vmaVirtualAllocate(pool.pages.back().block, &allocationInfo, &range.allocation, &offset));
+    range.offset = static_cast<uint32_t>(offset);
+    return range;
+}
+
+void MeshArena::Free(Pool& pool, const ArenaRange& range) {
+    vmaVirtualFree(pool.pages[range.page].block, range.allocation);
+}
+
+MeshArena::Page MeshArena::CreatePage(const Pool& pool, uint32_t capacity) const {
+    Page page{};
+
+    VmaVirtualBlockCreateInfo blockInfo{};
+    blockInfo.size = capacity;
+    VK_CHECK(vmaCreateVirtualBlock(&blockInfo, &page.block));
+
+    VkBufferCreateInfo bufferInfo = {.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    bufferInfo.size = capacity * pool.elementSize;
+    bufferInfo.usage = pool.usage;
+    // Uploads land from the transfer queue while the graphics queue draws from other ranges of the same page
+    if (queueFamilies_.size() > 1) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies_.size());
+        bufferInfo.pQueueFamilyIndices = queueFamilies_.data();
+    }
+
+    VmaAllocationCreateInfo allocationInfo = {};
+    allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    VK_CHECK(vmaCreateBuffer(allocator_, &bufferInfo, &allocationInfo, &page.buffer.buffer, &page.buffer.allocation, &page.buffer.info));
+
+    if (pool.usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) {
+        VkBufferDeviceAddressInfo deviceAddressInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO};
+        deviceAddressInfo.buffer = page.buffer.buffer;
+        page.address = vkGetBufferDeviceAddress(device_, &deviceAddressInfo);
+    }
+
+    fmt::println("Mesh arena: new page with {} elements of {} bytes", capacity, pool.elementSize);
+    return page;
+}
+}
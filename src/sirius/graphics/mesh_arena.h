@@ -0,0 +1,90 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "types.h"
+
+namespace sirius {
+// Vertex and index data of all meshes, sub-allocated from a few large buffers. Every page is one buffer managed by a VMA virtual block
+// that counts in elements, so an allocation's offset is directly the base vertex or first index of the mesh. Every vertex format and index type has pages of its own,
+// meshlets live in pages of their own too
+class MeshArena {
+public:
+    static constexpr uint32_t kVerticesPerPage = 1 << 20;
+    static constexpr uint32_t kIndicesPerPage = 1 << 24;
+    static constexpr uint32_t kMeshletsPerPage = 1 << 18;
+
+    // Pages are shared concurrently between the given queue families, a single family keeps them exclusive
+    void Init(VkDevice device, VmaAllocator allocator, std::vector<uint32_t> queueFamilies);
+
+    // Releases every page, including the ranges that are still allocated
+    void Destroy();
+
+    ArenaRange AllocateVertices(uint32_t count, VertexFormat format);
+
+    // Only VK_INDEX_TYPE_UINT16 and VK_INDEX_TYPE_UINT32
+    ArenaRange AllocateIndices(uint32_t count, VkIndexType type);
+
+    ArenaRange AllocateMeshlets(uint32_t count);
+
+    // The GPU must be done with the range
+    void FreeVertices(const ArenaRange& range, VertexFormat format);
+
+    void FreeIndices(const ArenaRange& range, VkIndexType type);
+
+    void FreeMeshlets(const ArenaRange& range);
+
+    [[nodiscard]] VkBuffer GetVertexBuffer(VertexFormat format, uint32_t page) const { return GetVertexPool(format).pages[page].buffer.buffer; }
+
+    [[nodiscard]] VkDeviceAddress GetVertexBufferAddress(VertexFormat format, uint32_t page) const { return GetVertexPool(format).pages[page].address; }
+
+    [[nodiscard]] VkBuffer GetIndexBuffer(VkIndexType type, uint32_t page) const { return GetIndexPool(type).pages[page].buffer.buffer; }
+
+    [[nodiscard]] VkDeviceAddress GetIndexBufferAddress(VkIndexType type, uint32_t page) const { return GetIndexPool(type).pages[page].address; }
+
+    [[nodiscard]] VkBuffer GetMeshletBuffer(uint32_t page) const { return meshletPool_.pages[page].buffer.buffer; }
+
+    [[nodiscard]] VkDeviceAddress GetMeshletBufferAddress(uint32_t page) const { return meshletPool_.pages[page].address; }
+
+    [[nodiscard]] uint32_t GetVertexPageCount(VertexFormat format) const { return static_cast<uint32_t>(GetVertexPool(format).pages.size()); }
+
+    [[nodiscard]] uint32_t GetIndexPageCount(VkIndexType type) const { return static_cast<uint32_t>(GetIndexPool(type).pages.size()); }
+
+private:
+    struct Page {
+        AllocatedBuffer buffer;
+        VkDeviceAddress address;
+        VmaVirtualBlock block;
+    };
+
+    struct Pool {
+        std::vector<Page> pages;
+        VkDeviceSize elementSize;
+        uint32_t elementsPerPage;
+        VkBufferUsageFlags usage;
+    };
+
+    [[nodiscard]] const Pool& GetVertexPool(VertexFormat format) const { return vertexPools_[static_cast<size_t>(format)]; }
+
+    [[nodiscard]] const Pool& GetIndexPool(VkIndexType type) const { return type == VK_INDEX_TYPE_UINT16 ? index16Pool_ : indexPool_; }
+
+    ArenaRange Allocate(Pool& pool, uint32_t count) const;
+
+    static void Free(Pool& pool, const ArenaRange& range);
+
+    Page CreatePage(const Pool& pool, uint32_t capacity) const;
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    VmaAllocator allocator_ = VK_NULL_HANDLE;
+    std::vector<uint32_t> queueFamilies_;
+    std::array<Pool, 2> vertexPools_{};
+    Pool indexPool_{};
+    Pool index16Pool_{};
+    Pool meshletPool_{};
+};
+}
@@ -0,0 +1,182 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "mesh_optimize.h"
+
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "core/profiler.h"
+#include "meshoptimizer.h"
+
+namespace sirius {
+namespace {
+// Overdraw ordering may cost this much of the vertex cache efficiency
+constexpr float kOverdrawThreshold = 1.05f;
+// Trades spatial compactness of the meshlets for tighter normal cones
+constexpr float kMeshletConeWeight = 0.25f;
+// Every LOD aims for this fraction of the triangles of the level before it
+constexpr float kLodReduction = 0.25f;
+// A level that keeps more than this fraction of the previous one's triangles is not worth its indices
+constexpr float kLodMinReduction = 0.8f;
+// Simplification stops there, relative to the mesh extent
+constexpr float kLodMaxError = 0.05f;
+// Surfaces this small are drawn at full detail at any distance
+constexpr uint32_t kLodMinTriangles = 64;
+
+// Splits the triangles of indices[start, start + count) into meshlets and appends them in meshlet order behind all indices, the range keeps its order.
+// Meshlet indices are relative to the start of the range
+uint32_t AppendMeshlets(std::vector<uint32_t>& indices, uint32_t start, uint32_t count, std::span<const Vertex> vertices, std::vector<Meshlet>& meshlets) {
+    const size_t maxClusters = meshopt_buildMeshletsBound(count, kMeshletMaxVertices, kMeshletMaxTriangles);
+    std::vector<meshopt_Meshlet> clusters(maxClusters);
+    std::vector<uint32_t> clusterVertices(maxClusters * kMeshletMaxVertices);
+    std::vector<uint8_t> clusterTriangles(maxClusters * kMeshletMaxTriangles * 3);
+
+    const size_t clusterCount = meshopt_buildMeshlets(clusters.data(), clusterVertices.data(), clusterTriangles.data(), indices.data() + start, count,
+                                                      &vertices[0].position.x, vertices.size(), sizeof(Vertex), kMeshletMaxVertices, kMeshletMaxTriangles,
+                                                      kMeshletConeWeight);
+
+    // Every triangle ends up in exactly one meshlet, so the copy is as long as the range
+    indices.reserve(indices.size() + count);
+    for (size_t i = 0; i < clusterCount; i++) {
+        const meshopt_Meshlet& cluster = clusters[i];
+        uint32_t* localVertices = &clusterVertices[cluster.vertex_offset];
+        uint8_t* localTriangles = &clusterTriangles[cluster.triangle_offset];
+        // The compacted index buffer draws a meshlet's triangles in a row, so they are ordered for the vertex cache within the meshlet
+        meshopt_optimizeMeshlet(localVertices, localTriangles, cluster.triangle_count, cluster.vertex_count);
+
+        const meshopt_Bounds bounds = meshopt_computeMeshletBounds(localVertices, localTriangles, cluster.triangle_count, &vertices[0].position.x, vertices.size(),
+                                                                   sizeof(Vertex));
+
+        Meshlet meshlet{};
+        meshlet.sphere = glm::vec4(bounds.center[0], bounds.center[1], bounds.center[2], bounds.radius);
+        meshlet.cone = glm::vec4(bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2], bounds.cone_cutoff);
+        meshlet.firstIndex = static_cast<uint32_t>(indices.size()) - start;
+        meshlet.triangleCount = cluster.triangle_count;
+        meshlets.push_back(meshlet);
+
+        for (uint32_t corner = 0; corner < cluster.triangle_count * 3; corner++) {
+            indices.push_back(localVertices[localTriangles[corner]]);
+        }
+    }
+    return static_cast<uint32_t>(clusterCount);
+}
+}
+
+uint64_t CountTransformedVertices(std::span<const uint32_t> indices, size_t vertexCount) {
+    return meshopt_analyzeVertexCache(indices.data(), indices.size(), vertexCount, kVertexCacheSize, 0, 0).vertices_transformed;
+}
+
+void MeshOptimizationStats::Add(const MeshOptimizationStats& other) {
+    triangleCount += other.triangleCount;
+    verticesBefore += other.verticesBefore;
+    verticesAfter += other.verticesAfter;
+    transformedBefore += other.transformedBefore;
+    transformedAfter += other.transformedAfter;
+    coarsestLodTriangles += other.coarsestLodTriangles;
+}
+
+MeshOptimizationStats OptimizeMesh(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices, std::span<const PackageSurface> surfaces) {
+    SRS_PROFILE_SCOPE("OptimizeMesh");
+    MeshOptimizationStats stats{};
+    stats.triangleCount = indices.size() / 3;
+    stats.verticesBefore = vertices.size();
+    stats.transformedBefore = CountTransformedVertices(indices, vertices.size());
+
+    bool triangleLists = indices.size() % 3 == 0;
+    for (const PackageSurface& surface : surfaces) {
+        triangleLists = triangleLists && surface.startIndex % 3 == 0 && surface.count % 3 == 0;
+    }
+    if (!triangleLists || vertices.empty()) {
+        stats.verticesAfter = stats.verticesBefore;
+        stats.transformedAfter = stats.transformedBefore;
+        return stats;
+    }
+
+    // Primitives of a glTF mesh each bring their own vertices, welding also joins the ones they share
+    std::vector<uint32_t> remap(vertices.size());
+    const size_t uniqueVertices = meshopt_generateVertexRemap(remap.data(), indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(Vertex));
+    meshopt_remapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+    meshopt_remapVertexBuffer(vertices.data(), vertices.data(), vertices.size(), sizeof(Vertex), remap.data());
+    vertices.resize(uniqueVertices);
+
+    for (const PackageSurface& surface : surfaces) {
+        uint32_t* surfaceIndices = indices.data() + surface.startIndex;
+        meshopt_optimizeVertexCache(surfaceIndices, surfaceIndices, surface.count, vertices.size());
+        meshopt_optimizeOverdraw(surfaceIndices, surfaceIndices, surface.count, &vertices[0].position.x, vertices.size(), sizeof(Vertex), kOverdrawThreshold);
+    }
+
+    // Drops the vertices no triangle uses
+    const size_t fetchedVertices = meshopt_optimizeVertexFetch(vertices.data(), indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(Vertex));
+    vertices.resize(fetchedVertices);
+
+    stats.verticesAfter = vertices.size();
+    stats.transformedAfter = CountTransformedVertices(indices, vertices.size());
+    return stats;
+}
+
+uint64_t BuildLods(std::vector<uint32_t>& indices, std::span<const Vertex> vertices, std::span<PackageSurface> surfaces) {
+    SRS_PROFILE_SCOPE("BuildLods");
+    uint64_t coarsestTriangles = 0;
+    if (vertices.empty()) {
+        return coarsestTriangles;
+    }
+
+    // Simplification reports its error relative to the mesh extent
+    const float errorScale = meshopt_simplifyScale(&vertices[0].position.x, vertices.size(), sizeof(Vertex));
+    std::vector<uint32_t> simplified;
+
+    for (PackageSurface& surface : surfaces) {
+        surface.lodCount = 0;
+        uint32_t previousCount = surface.count;
+        float previousError = 0.0f;
+
+        // Every level starts from the full detail triangles, so its error is measured against what it replaces on screen
+        while (surface.lodCount < kMaxLodLevels - 1 && surface.count % 3 == 0 && previousCount / 3 >= kLodMinTriangles) {
+            const size_t targetCount = static_cast<size_t>(static_cast<float>(previousCount / 3) * kLodReduction) * 3;
+            simplified.resize(surface.count);
+            float error = 0.0f;
+            const size_t count = meshopt_simplify(simplified.data(), indices.data() + surface.startIndex, surface.count, &vertices[0].position.x, vertices.size(),
+                                                  sizeof(Vertex), targetCount, kLodMaxError, meshopt_SimplifyLockBorder, &error);
+            if (count == 0 || static_cast<float>(count) > static_cast<float>(previousCount) * kLodMinReduction) {
+                break;
+            }
+            meshopt_optimizeVertexCache(simplified.data(), simplified.data(), count, vertices.size());
+
+            SurfaceLod& lod = surface.lods[surface.lodCount++];
+            lod.startIndex = static_cast<uint32_t>(indices.size());
+            lod.count = static_cast<uint32_t>(count);
+            lod.error = std::max(error * errorScale, previousError);
+            indices.insert(indices.end(), simplified.begin(), simplified.begin() + static_cast<std::ptrdiff_t>(count));
+
+            previousCount = lod.count;
+            previousError = lod.error;
+        }
+        coarsestTriangles += previousCount / 3;
+    }
+    return coarsestTriangles;
+}
+
+std::vector<Meshlet> BuildMeshlets(std::vector<uint32_t>& indices, std::span<const Vertex> vertices, std::span<PackageSurface> surfaces) {
+    SRS_PROFILE_SCOPE("BuildMeshlets");
+    std::vector<Meshlet> meshlets;
+
+    for (PackageSurface& surface : surfaces) {
+        surface.firstMeshlet = static_cast<uint32_t>(meshlets.size());
+        surface.meshletCount = 0;
+        if (surface.count == 0 || surface.count % 3 != 0) {
+            continue;
+        }
+        surface.meshletCount = AppendMeshlets(indices, surface.startIndex, surface.count, vertices, meshlets);
+
+        for (uint32_t i = 0; i < surface.lodCount; i++) {
+            SurfaceLod& lod = surface.lods[i];
+            lod.firstMeshlet = static_cast<uint32_t>(meshlets.size());
+            lod.meshletCount = AppendMeshlets(indices, lod.startIndex, lod.count, vertices, meshlets);
+        }
+    }
+    return meshlets;
+}
+}
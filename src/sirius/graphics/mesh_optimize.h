@@ -0,0 +1,52 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "scene_package.h"
+#include "types.h"
+
+namespace sirius {
+// Meshlet limits that suit both the compacted index path and mesh shaders
+constexpr uint32_t kMeshletMaxVertices = 64;
+constexpr uint32_t kMeshletMaxTriangles = 124;
+
+// Post-transform cache size the statistics are simulated with, in the range of current GPUs
+constexpr uint32_t kVertexCacheSize = 16;
+
+// Average cache miss ratio: vertex shader invocations per triangle, 3 without any reuse and about 0.5 at best
+struct MeshOptimizationStats {
+    uint64_t triangleCount;
+    uint64_t verticesBefore;
+    uint64_t verticesAfter;
+    uint64_t transformedBefore;
+    uint64_t transformedAfter;
+    // Triangles of every surface at its coarsest level
+    uint64_t coarsestLodTriangles;
+
+    void Add(const MeshOptimizationStats& other);
+
+    [[nodiscard]] double GetAcmrBefore() const { return triangleCount > 0 ? static_cast<double>(transformedBefore) / static_cast<double>(triangleCount) : 0.0; }
+
+    [[nodiscard]] double GetAcmrAfter() const { return triangleCount > 0 ? static_cast<double>(transformedAfter) / static_cast<double>(triangleCount) : 0.0; }
+};
+
+// Welds identical vertices, orders each surface's triangles for the vertex cache and then for overdraw, and finally orders the vertices by first use.
+// Triangles never move between surfaces, so their ranges and bounds stay valid. Meshes that are not triangle lists are left as they are
+MeshOptimizationStats OptimizeMesh(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices, std::span<const PackageSurface> surfaces);
+
+// Simplifies every surface down to kMaxLodLevels - 1 coarser levels and appends their indices behind the existing ones. Borders are locked,
+// so surfaces of the same mesh stay connected whatever level each of them draws. Returns the triangles of the coarsest levels
+uint64_t BuildLods(std::vector<uint32_t>& indices, std::span<const Vertex> vertices, std::span<PackageSurface> surfaces);
+
+// Splits every surface and each of its LODs into meshlets. The triangles are appended once more in meshlet order behind the existing indices, so each
+// meshlet is a contiguous range while draws without meshlet culling keep the optimized order. Sets the meshlet ranges, surfaces that are not triangle lists get none
+std::vector<Meshlet> BuildMeshlets(std::vector<uint32_t>& indices, std::span<const Vertex> vertices, std::span<PackageSurface> surfaces);
+
+uint64_t CountTransformedVertices(std::span<const uint32_t> indices, size_t vertexCount);
+}
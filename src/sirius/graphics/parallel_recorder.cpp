@@ -0,0 +1,88 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "parallel_recorder.h"
+
+#include <cassert>
+
+#include "core/jobs.h"
+#include "core/profiler.h"
+
+namespace sirius {
+void ParallelRecorder::Init(VkDevice device, uint32_t queueFamily, uint32_t frameCount) {
+    device_ = device;
+
+    VkCommandPoolCreateInfo commandPoolInfo = {.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    commandPoolInfo.queueFamilyIndex = queueFamily;
+
+    // The main thread and every worker
+    contexts_.resize(JobSystem::GetWorkerCount() + 1);
+    for (Context& context : contexts_) {
+        context.frames.resize(frameCount);
+        for (FramePool& framePool : context.frames) {
+            VK_CHECK(vkCreateCommandPool(device_, &commandPoolInfo, nullptr, &framePool.pool));
+        }
+    }
+}
+
+void ParallelRecorder::Destroy() {
+    for (const Context& context : contexts_) {
+        for (const FramePool& framePool : context.frames) {
+            vkDestroyCommandPool(device_, framePool.pool, nullptr);
+        }
+    }
+    contexts_.clear();
+}
+
+std::span<const VkCommandBuffer> ParallelRecorder::Record(uint32_t frameIndex, uint32_t chunkCount, const VkCommandBufferInheritanceInfo& inheritance, const RecordFunction& record) {
+    SRS_PROFILE_SCOPE("ParallelRecorder::Record");
+    assert(JobSystem::IsMainThread());
+
+    // Every pool of this frame is reset in one go, the buffers are reused without resetting them one by one
+    for (Context& context : contexts_) {
+        FramePool& framePool = context.frames[frameIndex];
+        VK_CHECK(vkResetCommandPool(device_, framePool.pool, 0));
+        framePool.used = 0;
+    }
+
+    recorded_.assign(chunkCount, VK_NULL_HANDLE);
+    JobSystem::ParallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end) {
+        const uint32_t threadIndex = JobSystem::GetThreadIndex();
+        assert(threadIndex < contexts_.size());
+        FramePool& framePool = contexts_[threadIndex].frames[frameIndex];
+
+        for (uint32_t chunk = begin; chunk < end; chunk++) {
+            SRS_PROFILE_SCOPE("Record chunk");
+            VkCommandBuffer cmd = AcquireCommandBuffer(framePool);
+
+            VkCommandBufferBeginInfo beginInfo = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+            beginInfo.pInheritanceInfo = &inheritance;
+            VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+
+            record(cmd, chunk);
+
+            VK_CHECK(vkEndCommandBuffer(cmd));
+            recorded_[chunk] = cmd;
+        }
+    });
+
+    return recorded_;
+}
+
+VkCommandBuffer ParallelRecorder::AcquireCommandBuffer(FramePool& framePool) const {
+    if (framePool.used == framePool.buffers.size()) {
+        VkCommandBufferAllocateInfo allocateInfo = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocateInfo.commandPool = framePool.pool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocateInfo.commandBufferCount = 1;
+
+        VkCommandBuffer cmd;
+        VK_CHECK(vkAllocateCommandBuffers(device_, &allocateInfo, &cmd));
+        framePool.buffers.push_back(cmd);
+    }
+    return framePool.buffers[framePool.used++];
+}
+}
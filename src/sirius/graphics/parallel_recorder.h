@@ -0,0 +1,49 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "types.h"
+
+namespace sirius {
+// Records secondary command buffers on the job system's threads. Each thread owns one command pool per frame in flight,
+// a pool is reset when its frame is recorded again
+class ParallelRecorder {
+public:
+    using RecordFunction = std::function<void(VkCommandBuffer cmd, uint32_t chunk)>;
+
+    // Call after JobSystem::Init, one set of pools is created per job system thread
+    void Init(VkDevice device, uint32_t queueFamily, uint32_t frameCount);
+
+    void Destroy();
+
+    // Calls record once per chunk with JobSystem::ParallelFor. Returns the secondaries in chunk order, valid until the frame is recorded again.
+    // Call from the main thread, the GPU must be done with the previous use of the frame
+    std::span<const VkCommandBuffer> Record(uint32_t frameIndex, uint32_t chunkCount, const VkCommandBufferInheritanceInfo& inheritance, const RecordFunction& record);
+
+    [[nodiscard]] uint32_t GetThreadCount() const { return static_cast<uint32_t>(contexts_.size()); }
+
+private:
+    struct FramePool {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> buffers;
+        uint32_t used = 0;
+    };
+
+    // Indexed by JobSystem::GetThreadIndex, a thread runs one chunk at a time so its pools need no lock
+    struct Context {
+        std::vector<FramePool> frames;
+    };
+
+    VkCommandBuffer AcquireCommandBuffer(FramePool& framePool) const;
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    std::vector<Context> contexts_;
+    std::vector<VkCommandBuffer> recorded_;
+};
+}
@@ -0,0 +1,173 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "pipeline_cache.h"
+
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "core/profiler.h"
+#include "core/utils.h"
+#include "types.h"
+
+namespace sirius {
+namespace {
+constexpr uint32_t kCacheMagic = 0x43505253; // "SRPC"
+constexpr uint32_t kCacheVersion = 1;
+
+// Vulkan validates the header of its own data as well, this one also rejects other driver versions and truncated or damaged files
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t dataSize;
+    uint64_t dataHash;
+    uint32_t vendorId;
+    uint32_t deviceId;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUuid[VK_UUID_SIZE];
+    uint32_t padding;
+};
+
+bool MatchesDevice(const CacheHeader& header, const VkPhysicalDeviceProperties& properties) {
+    return header.vendorId == properties.vendorID && header.deviceId == properties.deviceID && header.driverVersion == properties.driverVersion &&
+           std::memcmp(header.pipelineCacheUuid, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+// Empty if the file is missing or was not written for this device and driver
+std::vector<std::byte> ReadCacheFile(const std::filesystem::path& path, const VkPhysicalDeviceProperties& properties) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return {};
+    }
+
+    CacheHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.magic != kCacheMagic || header.version != kCacheVersion) {
+        return {};
+    }
+    if (!MatchesDevice(header, properties)) {
+        fmt::println("Pipeline cache: {} was written for another device or driver, starting empty", path.string());
+        return {};
+    }
+
+    std::vector<std::byte> data(header.dataSize);
+    file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    if (!file || Utils::HashBytes(data) != header.dataHash) {
+        return {};
+    }
+    return data;
+}
+}
+
+void PipelineCache::Init(VkDevice device, VkPhysicalDevice physicalDevice, std::filesystem::path path) {
+    SRS_PROFILE_SCOPE("PipelineCache::Init");
+    device_ = device;
+    path_ = std::move(path);
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties_);
+
+    const std::vector<std::byte> data = ReadCacheFile(path_, deviceProperties_);
+
+    VkPipelineCacheCreateInfo createInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.data();
+    if (vkCreatePipelineCache(device_, &createInfo, nullptr, &cache_) != VK_SUCCESS) {
+        // The driver refused the data, an empty cache still works
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+        VK_CHECK(vkCreatePipelineCache(device_, &createInfo, nullptr, &cache_));
+        return;
+    }
+    stats_.loadedBytes = data.size();
+}
+
+void PipelineCache::Save() const {
+    if (cache_ == VK_NULL_HANDLE) {
+        return;
+    }
+
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device_, cache_, &size, nullptr) != VK_SUCCESS) {
+        return;
+    }
+    std::vector<std::byte> data(size);
+    if (vkGetPipelineCacheData(device_, cache_, &size, data.data()) != VK_SUCCESS) {
+        return;
+    }
+    data.resize(size);
+
+    CacheHeader header{};
+    header.magic = kCacheMagic;
+    header.version = kCacheVersion;
+    header.dataSize = data.size();
+    header.dataHash = Utils::HashBytes(data);
+    header.vendorId = deviceProperties_.vendorID;
+    header.deviceId = deviceProperties_.deviceID;
+    header.driverVersion = deviceProperties_.driverVersion;
+    std::memcpy(header.pipelineCacheUuid, deviceProperties_.pipelineCacheUUID, VK_UUID_SIZE);
+
+    std::error_code error;
+    if (path_.has_parent_path()) {
+        std::filesystem::create_directories(path_.parent_path(), error);
+    }
+
+    if (!Utils::WriteFileAtomically(path_, {std::as_bytes(std::span(&header, 1)), std::span<const std::byte>(data)})) {
+        fmt::println("Pipeline cache: cannot write {}", path_.string());
+    }
+}
+
+void PipelineCache::Destroy() {
+    vkDestroyPipelineCache(device_, cache_, nullptr);
+    cache_ = VK_NULL_HANDLE;
+}
+
+VkResult PipelineCache::CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& info, VkPipeline* pipeline) {
+    VkPipelineCreationFeedback feedback{};
+    VkPipelineCreationFeedbackCreateInfo feedbackInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO};
+    feedbackInfo.pNext = info.pNext;
+    feedbackInfo.pPipelineCreationFeedback = &feedback;
+
+    VkGraphicsPipelineCreateInfo chainedInfo = info;
+    chainedInfo.pNext = &feedbackInfo;
+
+    const VkResult result = vkCreateGraphicsPipelines(device_, cache_, 1, &chainedInfo, nullptr, pipeline);
+    if (result == VK_SUCCESS) {
+        CountFeedback(feedback);
+    }
+    return result;
+}
+
+VkResult PipelineCache::CreateComputePipeline(const VkComputePipelineCreateInfo& info, VkPipeline* pipeline) {
+    VkPipelineCreationFeedback feedback{};
+    VkPipelineCreationFeedbackCreateInfo feedbackInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO};
+    feedbackInfo.pNext = info.pNext;
+    feedbackInfo.pPipelineCreationFeedback = &feedback;
+
+    VkComputePipelineCreateInfo chainedInfo = info;
+    chainedInfo.pNext = &feedbackInfo;
+
+    const VkResult result = vkCreateComputePipelines(device_, cache_, 1, &chainedInfo, nullptr, pipeline);
+    if (result == VK_SUCCESS) {
+        CountFeedback(feedback);
+    }
+    return result;
+}
+
+void PipelineCache::CountFeedback(const VkPipelineCreationFeedback& feedback) {
+    if ((feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) == 0) {
+        stats_.unknown++;
+        return;
+    }
+
+    if (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT) {
+        stats_.hits++;
+    } else {
+        stats_.misses++;
+    }
+    stats_.creationMs += static_cast<double>(feedback.duration) / 1e6;
+}
+}
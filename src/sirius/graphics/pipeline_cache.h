@@ -0,0 +1,51 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <filesystem>
+#include <vulkan/vulkan_core.h>
+
+namespace sirius {
+// Pipelines whose creation feedback reported a hit in the application's cache, those skipped shader compilation
+struct PipelineCacheStats {
+    // Size of the cache data accepted at startup, zero if the file was missing, outdated or written for another device or driver
+    size_t loadedBytes;
+    uint32_t hits;
+    uint32_t misses;
+    // The driver gave no valid feedback for these
+    uint32_t unknown;
+    double creationMs;
+};
+
+// One VkPipelineCache for every pipeline of the renderer, kept on disk between runs. The file is only used on the device and driver it was
+// written by, anything else starts with an empty cache
+class PipelineCache {
+public:
+    void Init(VkDevice device, VkPhysicalDevice physicalDevice, std::filesystem::path path);
+
+    // Writes the current contents back to the file, called on shutdown
+    void Save() const;
+
+    void Destroy();
+
+    // Both count the creation feedback into the stats
+    VkResult CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& info, VkPipeline* pipeline);
+
+    VkResult CreateComputePipeline(const VkComputePipelineCreateInfo& info, VkPipeline* pipeline);
+
+    [[nodiscard]] VkPipelineCache GetHandle() const { return cache_; }
+
+    [[nodiscard]] const PipelineCacheStats& GetStats() const { return stats_; }
+
+private:
+    void CountFeedback(const VkPipelineCreationFeedback& feedback);
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    VkPipelineCache cache_ = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties deviceProperties_{};
+    std::filesystem::path path_;
+    PipelineCacheStats stats_{};
+};
+}
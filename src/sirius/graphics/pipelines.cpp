@@ -11,7 +11,7 @@
 #include "fmt/base.h"
 #include "initializers.h"
 
-VkPipeline sirius::PipelineBuilder::BuildPipeline(VkDevice device) const {
+VkPipeline sirius::PipelineBuilder::BuildPipeline(PipelineCache& cache) const {
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.pNext = nullptr;
@@ -54,7 +54,7 @@ VkPipeline sirius::PipelineBuilder::BuildPipeline(VkDevice device) const {
     pipelineInfo.pDynamicState = &dynamicInfo;
 
     VkPipeline newPipeline;
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &newPipeline) != VK_SUCCESS) {
+    if (cache.CreateGraphicsPipeline(pipelineInfo, &newPipeline) != VK_SUCCESS) {
         fmt::println("failed to create pipeline");
         return VK_NULL_HANDLE; // failed to create graphics pipeline
     }
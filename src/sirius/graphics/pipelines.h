@@ -5,6 +5,8 @@
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
+#include "pipeline_cache.h"
+
 
 // TODO Handle unset pipeline info structs, maybe with optionals
 namespace sirius {
@@ -12,7 +14,8 @@ class PipelineBuilder {
 public:
     PipelineBuilder() { Clear(); }
 
-    VkPipeline BuildPipeline(VkDevice device) const;
+    // Returns VK_NULL_HANDLE if the pipeline could not be created
+    VkPipeline BuildPipeline(PipelineCache& cache) const;
 
     void Clear();
 
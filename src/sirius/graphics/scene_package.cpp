@@ -0,0 +1,188 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "scene_package.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace sirius {
+namespace {
+bool IsInside(const PackageSection& section, size_t fileSize) {
+    return section.offset % kPackageSectionAlignment == 0 && section.offset <= fileSize && section.size <= fileSize - section.offset;
+}
+
+// count elements from first fit into size, without overflowing
+bool IsInside(uint64_t first, uint64_t count, uint64_t size) {
+    return first <= size && count <= size - first;
+}
+
+template<typename T>
+void WriteSection(std::ofstream& file, std::span<const T> data, PackageSection& section) {
+    // Pad up to the alignment, the header in front is written last
+    const auto position = static_cast<uint64_t>(file.tellp());
+    const uint64_t offset = (position + kPackageSectionAlignment - 1) & ~(kPackageSectionAlignment - 1);
+    constexpr char kPadding[kPackageSectionAlignment] = {};
+    file.write(kPadding, static_cast<std::streamsize>(offset - position));
+
+    section.offset = offset;
+    section.size = data.size_bytes();
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size_bytes()));
+}
+}
+
+bool ScenePackage::Open(const std::filesystem::path& path) {
+    header_ = nullptr;
+    if (!file_.Open(path)) {
+        return false;
+    }
+
+    const std::span<const std::byte> data = file_.GetData();
+    if (data.size() < sizeof(PackageHeader)) {
+        return false;
+    }
+
+    const auto* header = reinterpret_cast<const PackageHeader*>(data.data());
+    if (header->magic != kScenePackageMagic || header->version != kScenePackageVersion) {
+        return false;
+    }
+
+    for (const PackageSection& section : {header->strings, header->samplers, header->images, header->materials, header->surfaces, header->meshes, header->nodes,
+                                          header->vertices, header->indices, header->meshlets, header->imageData}) {
+        if (!IsInside(section, data.size())) {
+            return false;
+        }
+    }
+
+    header_ = header;
+    if (!HasValidRanges()) {
+        header_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool ScenePackage::HasValidRanges() const {
+    const uint64_t stringsSize = header_->strings.size;
+    const auto isString = [&](PackageString string) { return IsInside(string.offset, string.length, stringsSize); };
+    // kPackageNone or an element of a section with count elements
+    const auto isReference = [](uint32_t index, size_t count) { return index == kPackageNone || index < count; };
+
+    const std::span<const PackageImage> images = GetImages();
+    for (const PackageImage& image : images) {
+        if (!isString(image.name) || !IsInside(image.offset, image.size, header_->imageData.size)) {
+            return false;
+        }
+        if (image.kind == PackageImageKind::kRgba8 && image.size != static_cast<uint64_t>(image.width) * image.height * 4) {
+            return false;
+        }
+        if (image.kind != PackageImageKind::kRgba8 && image.kind != PackageImageKind::kKtx2) {
+            return false;
+        }
+    }
+
+    const std::span<const PackageMaterial> materials = GetMaterials();
+    for (const PackageMaterial& material : materials) {
+        if (!isString(material.name) || !isReference(material.colorImage, images.size()) || !isReference(material.colorSampler, GetSamplers().size())) {
+            return false;
+        }
+    }
+
+    const std::span<const PackageSurface> surfaces = GetSurfaces();
+    const std::span<const PackageMesh> meshes = GetMeshes();
+    for (const PackageMesh& mesh : meshes) {
+        if (!isString(mesh.name) || !IsInside(mesh.firstSurface, mesh.surfaceCount, surfaces.size()) || !IsInside(mesh.firstMeshlet, mesh.meshletCount, GetMeshlets().size())) {
+            return false;
+        }
+        if ((mesh.vertexFormat != VertexFormat::kFull && mesh.vertexFormat != VertexFormat::kCompact) || !IsInside(mesh.vertexOffset, mesh.vertexSize, header_->vertices.size) ||
+            mesh.vertexSize % GetVertexStride(mesh.vertexFormat) != 0) {
+            return false;
+        }
+        if ((mesh.indexType != VK_INDEX_TYPE_UINT16 && mesh.indexType != VK_INDEX_TYPE_UINT32) || !IsInside(mesh.indexOffset, mesh.indexSize, header_->indices.size) ||
+            mesh.indexSize % GetIndexSize(mesh.indexType) != 0) {
+            return false;
+        }
+        const uint64_t indexCount = mesh.indexSize / GetIndexSize(mesh.indexType);
+
+        // Surfaces and their levels are relative to the mesh
+        for (const PackageSurface& surface : surfaces.subspan(mesh.firstSurface, mesh.surfaceCount)) {
+            if (!IsInside(surface.startIndex, surface.count, indexCount) || !IsInside(surface.firstMeshlet, surface.meshletCount, mesh.meshletCount) ||
+                !isReference(surface.material, materials.size()) || surface.lodCount > surface.lods.size()) {
+                return false;
+            }
+            for (const SurfaceLod& lod : std::span(surface.lods).first(surface.lodCount)) {
+                if (!IsInside(lod.startIndex, lod.count, indexCount) || !IsInside(lod.firstMeshlet, lod.meshletCount, mesh.meshletCount)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    const std::span<const PackageNode> nodes = GetNodes();
+    for (size_t i = 0; i < nodes.size(); i++) {
+        // Parents come first
+        if (!isString(nodes[i].name) || !isReference(nodes[i].parent, i) || !isReference(nodes[i].mesh, meshes.size())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string_view ScenePackage::GetString(PackageString string) const {
+    const auto* strings = reinterpret_cast<const char*>(file_.GetData().data() + header_->strings.offset);
+    return {strings + string.offset, string.length};
+}
+
+std::span<const std::byte> ScenePackage::GetImageData(const PackageImage& image) const {
+    return file_.GetData().subspan(header_->imageData.offset + image.offset, image.size);
+}
+
+VertexData ScenePackage::GetVertices(const PackageMesh& mesh) const {
+    return {mesh.vertexFormat, mesh.quantization, file_.GetData().subspan(header_->vertices.offset + mesh.vertexOffset, mesh.vertexSize)};
+}
+
+IndexData ScenePackage::GetIndices(const PackageMesh& mesh) const {
+    return {mesh.indexType, file_.GetData().subspan(header_->indices.offset + mesh.indexOffset, mesh.indexSize)};
+}
+
+PackageString ScenePackageWriter::AddString(std::string_view string) {
+    const PackageString packageString{static_cast<uint32_t>(strings_.size()), static_cast<uint32_t>(string.size())};
+    strings_.insert(strings_.end(), string.begin(), string.end());
+    return packageString;
+}
+
+uint64_t ScenePackageWriter::AddImageData(std::span<const std::byte> data) {
+    const uint64_t offset = imageData_.size();
+    imageData_.insert(imageData_.end(), data.begin(), data.end());
+    return offset;
+}
+
+bool ScenePackageWriter::Write(const std::filesystem::path& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    PackageHeader header{};
+    header.magic = kScenePackageMagic;
+    header.version = kScenePackageVersion;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    WriteSection(file, std::span(strings_), header.strings);
+    WriteSection(file, std::span(samplers_), header.samplers);
+    WriteSection(file, std::span(images_), header.images);
+    WriteSection(file, std::span(materials_), header.materials);
+    WriteSection(file, std::span(surfaces_), header.surfaces);
+    WriteSection(file, std::span(meshes_), header.meshes);
+    WriteSection(file, std::span(nodes_), header.nodes);
+    WriteSection(file, std::span(vertices_), header.vertices);
+    WriteSection(file, std::span(indices_), header.indices);
+    WriteSection(file, std::span(meshlets_), header.meshlets);
+    WriteSection(file, std::span(imageData_), header.imageData);
+
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    return file.good();
+}
+}
@@ -0,0 +1,195 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "types.h"
+#include "vertex_compression.h"
+#include "core/mapped_file.h"
+
+namespace sirius {
+// Binary scene written offline by sirius-cook. Every section is an array of the structs below that the loader uses in place,
+// vertices and indices are in the layout the GPU reads. Only valid on the platform that cooked it
+constexpr uint32_t kScenePackageMagic = 0x4b505253; // "SRPK"
+constexpr uint32_t kScenePackageVersion = 5;
+constexpr uint32_t kPackageNone = UINT32_MAX;
+constexpr std::string_view kScenePackageExtension = ".srspkg";
+
+// Byte range in the file, aligned to kPackageSectionAlignment
+struct PackageSection {
+    uint64_t offset;
+    uint64_t size;
+};
+
+// Byte range in the strings section, not null terminated
+struct PackageString {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct PackageSampler {
+    VkFilter magFilter;
+    VkFilter minFilter;
+    VkSamplerMipmapMode mipmapMode;
+};
+
+enum class PackageImageKind : uint32_t {
+    // Decoded first level, the mips are generated at load
+    kRgba8,
+    // Untouched KTX2 file, transcoded at load for the device
+    kKtx2,
+};
+
+struct PackageImage {
+    PackageString name;
+    PackageImageKind kind;
+    uint32_t width;
+    uint32_t height;
+    uint32_t padding;
+    // Byte range in the image data section
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct PackageMaterial {
+    PackageString name;
+    glm::vec4 colorFactors;
+    glm::vec4 metalRoughFactors;
+    MaterialPass passType;
+    // kPackageNone for the renderer defaults
+    uint32_t colorImage;
+    uint32_t colorSampler;
+    uint32_t doubleSided;
+};
+
+struct PackageSurface {
+    uint32_t startIndex;
+    uint32_t count;
+    // kPackageNone for surfaces without a material
+    uint32_t material;
+    // Relative to the mesh's first meshlet
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+    // Simplified levels from fine to coarse, their error only grows
+    uint32_t lodCount;
+    std::array<SurfaceLod, kMaxLodLevels - 1> lods;
+    Bounds bounds;
+};
+
+struct PackageMesh {
+    PackageString name;
+    uint32_t firstSurface;
+    uint32_t surfaceCount;
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+    // Packed by sirius-cook, the quantization is only used by compact vertices
+    VertexFormat vertexFormat;
+    VertexQuantization quantization;
+    VkIndexType indexType;
+    // Byte ranges in the vertex and index sections, the strides come from the vertex format and index type.
+    // Indices are relative to the mesh's first vertex
+    uint64_t vertexOffset;
+    uint64_t vertexSize;
+    uint64_t indexOffset;
+    uint64_t indexSize;
+    Bounds bounds;
+};
+
+// Parents come before their children
+struct PackageNode {
+    PackageString name;
+    uint32_t parent;
+    uint32_t mesh;
+    glm::mat4 localTransform;
+};
+
+struct PackageHeader {
+    uint32_t magic;
+    uint32_t version;
+    PackageSection strings;
+    PackageSection samplers;
+    PackageSection images;
+    PackageSection materials;
+    PackageSection surfaces;
+    PackageSection meshes;
+    PackageSection nodes;
+    PackageSection vertices;
+    PackageSection indices;
+    PackageSection meshlets;
+    PackageSection imageData;
+};
+
+constexpr uint64_t kPackageSectionAlignment = 16;
+
+static_assert(std::is_trivially_copyable_v<PackageMaterial> && std::is_trivially_copyable_v<PackageMesh> && std::is_trivially_copyable_v<PackageNode>);
+
+// Maps a package and hands out its sections without copying them
+class ScenePackage {
+public:
+    // Returns false if the file cannot be mapped, is not a package of this version or any range or index in it points outside its section.
+    // Vertex indices and meshlets are not checked, they are only read by the GPU
+    bool Open(const std::filesystem::path& path);
+
+    [[nodiscard]] std::string_view GetString(PackageString string) const;
+
+    [[nodiscard]] std::span<const PackageSampler> GetSamplers() const { return GetSection<PackageSampler>(header_->samplers); }
+    [[nodiscard]] std::span<const PackageImage> GetImages() const { return GetSection<PackageImage>(header_->images); }
+    [[nodiscard]] std::span<const PackageMaterial> GetMaterials() const { return GetSection<PackageMaterial>(header_->materials); }
+    [[nodiscard]] std::span<const PackageSurface> GetSurfaces() const { return GetSection<PackageSurface>(header_->surfaces); }
+    [[nodiscard]] std::span<const PackageMesh> GetMeshes() const { return GetSection<PackageMesh>(header_->meshes); }
+    [[nodiscard]] std::span<const PackageNode> GetNodes() const { return GetSection<PackageNode>(header_->nodes); }
+    [[nodiscard]] VertexData GetVertices(const PackageMesh& mesh) const;
+    [[nodiscard]] IndexData GetIndices(const PackageMesh& mesh) const;
+    [[nodiscard]] std::span<const Meshlet> GetMeshlets() const { return GetSection<Meshlet>(header_->meshlets); }
+
+    [[nodiscard]] std::span<const std::byte> GetImageData(const PackageImage& image) const;
+
+    [[nodiscard]] size_t GetFileSize() const { return file_.GetData().size(); }
+
+private:
+    [[nodiscard]] bool HasValidRanges() const;
+
+    template<typename T>
+    std::span<const T> GetSection(const PackageSection& section) const {
+        return {reinterpret_cast<const T*>(file_.GetData().data() + section.offset), section.size / sizeof(T)};
+    }
+
+    MappedFile file_;
+    const PackageHeader* header_ = nullptr;
+};
+
+// Collects the sections of a package and writes them out in one go
+class ScenePackageWriter {
+public:
+    PackageString AddString(std::string_view string);
+
+    // Returns the offset in the image data section
+    uint64_t AddImageData(std::span<const std::byte> data);
+
+    bool Write(const std::filesystem::path& path) const;
+
+    std::vector<PackageSampler> samplers_;
+    std::vector<PackageImage> images_;
+    std::vector<PackageMaterial> materials_;
+    std::vector<PackageSurface> surfaces_;
+    std::vector<PackageMesh> meshes_;
+    std::vector<PackageNode> nodes_;
+    // Every mesh's vertices and indices in the formats they were packed in
+    std::vector<std::byte> vertices_;
+    std::vector<std::byte> indices_;
+    std::vector<Meshlet> meshlets_;
+
+private:
+    std::vector<char> strings_;
+    std::vector<std::byte> imageData_;
+};
+}
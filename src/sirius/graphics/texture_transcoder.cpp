@@ -0,0 +1,235 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "texture_transcoder.h"
+
+#include <cstring>
+#include <fstream>
+
+#include <fmt/format.h>
+#include <ktx.h>
+
+#include "core/profiler.h"
+#include "core/utils.h"
+
+namespace sirius {
+namespace {
+constexpr uint32_t kCacheMagic = 0x43545253; // "SRTC"
+constexpr uint32_t kCacheVersion = 1;
+// Satisfies the texel block alignment of every format we transcode to
+constexpr VkDeviceSize kLevelAlignment = 16;
+
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint64_t dataSize;
+};
+
+bool CanSample(VkPhysicalDevice physicalDevice, VkFormat format) {
+    constexpr VkFormatFeatureFlags kRequired = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+    return (properties.optimalTilingFeatures & kRequired) == kRequired;
+}
+
+// PNG and JPEG textures are created as R8G8B8A8_UNORM and the shaders use the stored values as they are, so sRGB tagged KTX2 data
+// is created as the matching UNORM format to look the same
+VkFormat ToUnorm(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_SRGB: return VK_FORMAT_R8G8B8A8_UNORM;
+        case VK_FORMAT_B8G8R8A8_SRGB: return VK_FORMAT_B8G8R8A8_UNORM;
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK: return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        case VK_FORMAT_BC2_SRGB_BLOCK: return VK_FORMAT_BC2_UNORM_BLOCK;
+        case VK_FORMAT_BC3_SRGB_BLOCK: return VK_FORMAT_BC3_UNORM_BLOCK;
+        case VK_FORMAT_BC7_SRGB_BLOCK: return VK_FORMAT_BC7_UNORM_BLOCK;
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK: return VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK;
+        case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK: return VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK;
+        case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK: return VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK;
+        case VK_FORMAT_ASTC_4x4_SRGB_BLOCK: return VK_FORMAT_ASTC_4x4_UNORM_BLOCK;
+        case VK_FORMAT_ASTC_6x6_SRGB_BLOCK: return VK_FORMAT_ASTC_6x6_UNORM_BLOCK;
+        case VK_FORMAT_ASTC_8x8_SRGB_BLOCK: return VK_FORMAT_ASTC_8x8_UNORM_BLOCK;
+        default: return format;
+    }
+}
+}
+
+void TextureTranscoder::Init(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceFeatures& enabledFeatures, std::filesystem::path cacheDirectory) {
+    physicalDevice_ = physicalDevice;
+    enabledFeatures_ = enabledFeatures;
+    cacheDirectory_ = std::move(cacheDirectory);
+
+    // Every target is checked with the exact format its images are created with
+    const Target bc7 = {KTX_TTF_BC7_RGBA, VK_FORMAT_BC7_UNORM_BLOCK, "BC7"};
+    const Target bc1 = {KTX_TTF_BC1_RGB, VK_FORMAT_BC1_RGB_UNORM_BLOCK, "BC1"};
+    const Target bc3 = {KTX_TTF_BC3_RGBA, VK_FORMAT_BC3_UNORM_BLOCK, "BC3"};
+    const Target astc = {KTX_TTF_ASTC_4x4_RGBA, VK_FORMAT_ASTC_4x4_UNORM_BLOCK, "ASTC 4x4"};
+
+    if (CanUse(bc7.format)) {
+        opaqueTarget_ = bc7;
+        alphaTarget_ = bc7;
+    } else if (CanUse(bc1.format) && CanUse(bc3.format)) {
+        opaqueTarget_ = bc1;
+        alphaTarget_ = bc3;
+    } else if (CanUse(astc.format)) {
+        opaqueTarget_ = astc;
+        alphaTarget_ = astc;
+    } else {
+        // Software rasterizers like lavapipe may have no block formats at all
+        opaqueTarget_ = {KTX_TTF_RGBA32, VK_FORMAT_R8G8B8A8_UNORM, "RGBA8"};
+        alphaTarget_ = opaqueTarget_;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(cacheDirectory_, error);
+    if (error) {
+        fmt::println("Texture cache: cannot create {}: {}", cacheDirectory_.string(), error.message());
+    }
+
+    fmt::println("Texture transcoder: {} for opaque and {} for transparent textures", opaqueTarget_.name, alphaTarget_.name);
+}
+
+std::optional<TranscodedTexture> TextureTranscoder::Transcode(std::span<const std::byte> ktx2) {
+    SRS_PROFILE_SCOPE("TextureTranscoder::Transcode");
+    if (!IsKtx2(ktx2)) {
+        return std::nullopt;
+    }
+
+    // Both targets are part of the key, another device may pick other formats for the same file
+    const std::filesystem::path cachePath = cacheDirectory_ / fmt::format("{:016x}-{}-{}.tex", Utils::HashBytes(ktx2), opaqueTarget_.transcodeFormat, alphaTarget_.transcodeFormat);
+
+    std::optional<TranscodedTexture> texture = ReadCache(cachePath);
+    if (texture) {
+        cacheHits_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        cacheMisses_.fetch_add(1, std::memory_order_relaxed);
+        texture = TranscodeUncached(ktx2);
+        if (texture) {
+            WriteCache(cachePath, *texture);
+        }
+    }
+
+    // Transcoded textures always pass, but files stored in a GPU format can hold anything
+    if (texture && !CanUse(texture->format)) {
+        fmt::println("KTX2 texture format {} cannot be sampled on this device", string_VkFormat(texture->format));
+        return std::nullopt;
+    }
+    return texture;
+}
+
+bool TextureTranscoder::CanUse(VkFormat format) const {
+    if (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK && enabledFeatures_.textureCompressionBC != VK_TRUE) {
+        return false;
+    }
+    if (format >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK && format <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK && enabledFeatures_.textureCompressionETC2 != VK_TRUE) {
+        return false;
+    }
+    if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK && enabledFeatures_.textureCompressionASTC_LDR != VK_TRUE) {
+        return false;
+    }
+    return format != VK_FORMAT_UNDEFINED && CanSample(physicalDevice_, format);
+}
+
+bool TextureTranscoder::IsKtx2(std::span<const std::byte> data) {
+    constexpr uint8_t kIdentifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    return data.size() >= sizeof(kIdentifier) && memcmp(data.data(), kIdentifier, sizeof(kIdentifier)) == 0;
+}
+
+std::optional<TranscodedTexture> TextureTranscoder::TranscodeUncached(std::span<const std::byte> ktx2) {
+    ktxTexture2* texture = nullptr;
+    ktx_error_code_e result = ktxTexture2_CreateFromMemory(reinterpret_cast<const ktx_uint8_t*>(ktx2.data()), ktx2.size(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &texture);
+    if (result != KTX_SUCCESS) {
+        fmt::println("Failed to read KTX2 texture: {}", ktxErrorString(result));
+        return std::nullopt;
+    }
+
+    // Textures stored in a GPU format keep their data, only an sRGB format is swapped for its UNORM twin.
+    // libktx reports the sRGB variant of the target for sRGB tagged Basis data, so the format is always picked here
+    VkFormat format = ToUnorm(static_cast<VkFormat>(texture->vkFormat));
+    if (ktxTexture2_NeedsTranscoding(texture)) {
+        // ETC1S stores alpha in a second slice, so two components means RGB and alpha
+        const uint32_t components = ktxTexture2_GetNumComponents(texture);
+        const Target& target = components == 2 || components == 4 ? alphaTarget_ : opaqueTarget_;
+        format = target.format;
+
+        std::unique_lock lock(firstTranscodeMutex_, std::defer_lock);
+        if (!transcoderReady_.load(std::memory_order_acquire)) {
+            lock.lock();
+        }
+        result = ktxTexture2_TranscodeBasis(texture, static_cast<ktx_transcode_fmt_e>(target.transcodeFormat), 0);
+        transcoderReady_.store(true, std::memory_order_release);
+
+        if (result != KTX_SUCCESS) {
+            fmt::println("Failed to transcode KTX2 texture to {}: {}", target.name, ktxErrorString(result));
+            ktxTexture_Destroy(ktxTexture(texture));
+            return std::nullopt;
+        }
+    }
+
+    TranscodedTexture transcoded{};
+    transcoded.format = format;
+    transcoded.extent = {texture->baseWidth, texture->baseHeight, 1};
+
+    const ktx_uint8_t* data = ktxTexture_GetData(ktxTexture(texture));
+    for (uint32_t level = 0; level < texture->numLevels; level++) {
+        ktx_size_t offset = 0;
+        ktxTexture_GetImageOffset(ktxTexture(texture), level, 0, 0, &offset);
+        const ktx_size_t size = ktxTexture_GetImageSize(ktxTexture(texture), level);
+
+        const VkDeviceSize start = (transcoded.data.size() + kLevelAlignment - 1) & ~(kLevelAlignment - 1);
+        transcoded.data.resize(start + size);
+        memcpy(transcoded.data.data() + start, data + offset, size);
+        transcoded.levelOffsets.push_back(start);
+    }
+
+    ktxTexture_Destroy(ktxTexture(texture));
+    return transcoded;
+}
+
+std::optional<TranscodedTexture> TextureTranscoder::ReadCache(const std::filesystem::path& path) const {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return std::nullopt;
+    }
+
+    CacheHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.magic != kCacheMagic || header.version != kCacheVersion || header.levelCount == 0) {
+        return std::nullopt;
+    }
+
+    TranscodedTexture texture{};
+    texture.format = static_cast<VkFormat>(header.format);
+    texture.extent = {header.width, header.height, 1};
+    texture.levelOffsets.resize(header.levelCount);
+    texture.data.resize(header.dataSize);
+    file.read(reinterpret_cast<char*>(texture.levelOffsets.data()), static_cast<std::streamsize>(texture.levelOffsets.size() * sizeof(VkDeviceSize)));
+    file.read(reinterpret_cast<char*>(texture.data.data()), static_cast<std::streamsize>(texture.data.size()));
+
+    // A truncated file is treated like a miss and written again
+    if (!file) {
+        return std::nullopt;
+    }
+    return texture;
+}
+
+void TextureTranscoder::WriteCache(const std::filesystem::path& path, const TranscodedTexture& texture) const {
+    const CacheHeader header{
+        .magic = kCacheMagic,
+        .version = kCacheVersion,
+        .format = static_cast<uint32_t>(texture.format),
+        .width = texture.extent.width,
+        .height = texture.extent.height,
+        .levelCount = static_cast<uint32_t>(texture.levelOffsets.size()),
+        .dataSize = texture.data.size(),
+    };
+
+    Utils::WriteFileAtomically(path, {std::as_bytes(std::span(&header, 1)), std::as_bytes(std::span(texture.levelOffsets)), std::as_bytes(std::span(texture.data))});
+}
+}
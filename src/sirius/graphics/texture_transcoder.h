@@ -0,0 +1,72 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "types.h"
+
+namespace sirius {
+// Texture with all its mip levels, ready to be copied into an image
+struct TranscodedTexture {
+    VkFormat format;
+    VkExtent3D extent;
+    std::vector<std::byte> data;
+    // Start of each mip level in data, level 0 first
+    std::vector<VkDeviceSize> levelOffsets;
+};
+
+// Transcodes KTX2 / Basis Universal textures to the best block format the device can sample: BC7, BC1 / BC3, ASTC 4x4 or RGBA8 as the
+// last resort. Results are cached on disk, keyed by a hash of the KTX2 data and the target format, so later runs skip the transcoding
+class TextureTranscoder {
+public:
+    // enabledFeatures are the features the device was created with
+    void Init(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceFeatures& enabledFeatures, std::filesystem::path cacheDirectory);
+
+    // Thread safe. Returns nothing if the data is not a KTX2 file that can be transcoded
+    std::optional<TranscodedTexture> Transcode(std::span<const std::byte> ktx2);
+
+    [[nodiscard]] static bool IsKtx2(std::span<const std::byte> data);
+
+    [[nodiscard]] uint32_t GetCacheHits() const { return cacheHits_.load(std::memory_order_relaxed); }
+
+    [[nodiscard]] uint32_t GetCacheMisses() const { return cacheMisses_.load(std::memory_order_relaxed); }
+
+private:
+    // Values of ktx_transcode_fmt_e, kept out of the header so it does not need ktx.h. format is the image format we create for it
+    struct Target {
+        uint32_t transcodeFormat;
+        VkFormat format;
+        const char* name;
+    };
+
+    // The compression feature of the format is enabled and the device samples it with linear filtering
+    [[nodiscard]] bool CanUse(VkFormat format) const;
+
+    std::optional<TranscodedTexture> TranscodeUncached(std::span<const std::byte> ktx2);
+
+    std::optional<TranscodedTexture> ReadCache(const std::filesystem::path& path) const;
+
+    void WriteCache(const std::filesystem::path& path, const TranscodedTexture& texture) const;
+
+    VkPhysicalDevice physicalDevice_ = VK_NULL_HANDLE;
+    VkPhysicalDeviceFeatures enabledFeatures_{};
+    Target opaqueTarget_{};
+    Target alphaTarget_{};
+    std::filesystem::path cacheDirectory_;
+
+    // The first transcode initializes the global tables of the Basis transcoder, it must not race with another one
+    std::mutex firstTranscodeMutex_;
+    std::atomic<bool> transcoderReady_{false};
+
+    std::atomic<uint32_t> cacheHits_{0};
+    std::atomic<uint32_t> cacheMisses_{0};
+};
+}
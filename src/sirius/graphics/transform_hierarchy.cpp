@@ -0,0 +1,65 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "transform_hierarchy.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "core/profiler.h"
+
+namespace sirius {
+uint32_t TransformHierarchy::Add(uint32_t parent, const glm::mat4& localTransform) {
+    const auto node = static_cast<uint32_t>(parents_.size());
+    assert(parent == kNoParent || parent < node);
+
+    parents_.push_back(parent);
+    localTransforms_.push_back(localTransform);
+    worldTransforms_.push_back(localTransform);
+    dirty_.push_back(1);
+    updateEpochs_.push_back(0);
+    firstDirty_ = std::min(firstDirty_, node);
+    return node;
+}
+
+void TransformHierarchy::SetLocalTransform(uint32_t node, const glm::mat4& localTransform) {
+    localTransforms_[node] = localTransform;
+    dirty_[node] = 1;
+    firstDirty_ = std::min(firstDirty_, node);
+}
+
+uint32_t TransformHierarchy::Update() {
+    SRS_PROFILE_SCOPE("TransformHierarchy::Update");
+    // Nothing ever recomputed counts as epoch 0, so the first Update is epoch 1
+    epoch_++;
+    updatedBegin_ = 0;
+    updatedEnd_ = 0;
+    if (firstDirty_ == UINT32_MAX) {
+        return 0;
+    }
+
+    // A parent is always visited before its children, so it is already known whether it moved
+    uint32_t updated = 0;
+    const uint32_t count = GetCount();
+    for (uint32_t node = firstDirty_; node < count; node++) {
+        const uint32_t parent = parents_[node];
+        const bool parentMoved = parent != kNoParent && updateEpochs_[parent] == epoch_;
+        if (!dirty_[node] && !parentMoved) {
+            continue;
+        }
+
+        worldTransforms_[node] = parent != kNoParent ? worldTransforms_[parent] * localTransforms_[node] : localTransforms_[node];
+        dirty_[node] = 0;
+        updateEpochs_[node] = epoch_;
+        if (updated == 0) {
+            updatedBegin_ = node;
+        }
+        updatedEnd_ = node + 1;
+        updated++;
+    }
+
+    firstDirty_ = UINT32_MAX;
+    return updated;
+}
+}
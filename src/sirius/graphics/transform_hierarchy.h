@@ -0,0 +1,54 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <mat4x4.hpp>
+#include <vector>
+
+namespace sirius {
+// Local and world transforms of a node hierarchy in flat arrays, parents always come before their children. Setting a local transform only
+// marks the node dirty, Update then recomputes the dirty nodes and their descendants in one linear pass starting at the first dirty node
+class TransformHierarchy {
+public:
+    static constexpr uint32_t kNoParent = UINT32_MAX;
+
+    // The parent has to exist already, which keeps the arrays parent sorted. New nodes start dirty
+    uint32_t Add(uint32_t parent, const glm::mat4& localTransform);
+
+    void SetLocalTransform(uint32_t node, const glm::mat4& localTransform);
+
+    [[nodiscard]] const glm::mat4& GetLocalTransform(uint32_t node) const { return localTransforms_[node]; }
+
+    // As of the last Update
+    [[nodiscard]] const glm::mat4& GetWorldTransform(uint32_t node) const { return worldTransforms_[node]; }
+
+    [[nodiscard]] uint32_t GetParent(uint32_t node) const { return parents_[node]; }
+
+    [[nodiscard]] uint32_t GetCount() const { return static_cast<uint32_t>(parents_.size()); }
+
+    // Returns the number of world transforms that were recomputed
+    uint32_t Update();
+
+    // The world transform of the node changed in the last Update
+    [[nodiscard]] bool WasUpdated(uint32_t node) const { return updateEpochs_[node] == epoch_; }
+
+    // Half open range of the nodes the last Update may have changed, empty if it changed none
+    [[nodiscard]] uint32_t GetUpdatedBegin() const { return updatedBegin_; }
+    [[nodiscard]] uint32_t GetUpdatedEnd() const { return updatedEnd_; }
+
+private:
+    std::vector<uint32_t> parents_;
+    std::vector<glm::mat4> localTransforms_;
+    std::vector<glm::mat4> worldTransforms_;
+    std::vector<uint8_t> dirty_;
+    // Epoch of the Update that last recomputed each node, so the changed flags never have to be cleared
+    std::vector<uint32_t> updateEpochs_;
+    uint32_t epoch_ = 0;
+    uint32_t firstDirty_ = UINT32_MAX;
+    uint32_t updatedBegin_ = 0;
+    uint32_t updatedEnd_ = 0;
+};
+}
@@ -13,10 +13,10 @@
 
 #include <vulkan/vk_enum_string_helper.h>
 #include "vk_mem_alloc.h"
+#include "culling.h"
+#include "transform_hierarchy.h"
 
 namespace sirius {
-struct DrawContext;
-
 struct AllocatedImage {
     VkImage image;
     VkImageView imageView;
@@ -41,15 +41,146 @@ struct Vertex {
     glm::vec4 color;
 };
 
+enum class VertexFormat : uint32_t {
+    // Vertex, 48 bytes
+    kFull,
+    // CompactVertex, 16 bytes
+    kCompact,
+};
+
+// Quantized vertex, decoded in the vertex shader. Matches CompactVertex in vertex.glsl
+struct CompactVertex {
+    // unorm16 x and y of the position within the mesh's quantization box
+    uint32_t positionXY;
+    // unorm16 z of the position, then the octahedral normal as two snorm8
+    uint32_t positionZNormal;
+    // Two half floats
+    uint32_t uv;
+    // unorm8 RGBA
+    uint32_t color;
+};
+
+// Maps the unorm positions of compact vertices back to mesh space: position * scale + offset
+struct VertexQuantization {
+    glm::vec3 offset;
+    glm::vec3 scale;
+};
+
+// Cluster of triangles of one surface, culled on its own by the meshlet cull shader. Matches Meshlet in object_data.glsl
+struct Meshlet {
+    // Bounding sphere in mesh space, w is the radius
+    glm::vec4 sphere;
+    // Normal cone, w is the cutoff. Every triangle faces away from a viewer with dot(normalize(center - viewer), axis) >= cutoff + radius / distance
+    glm::vec4 cone;
+    // Relative to the first index of its surface or LOD. It points into the meshlet ordered copy behind all draw indices of the mesh, where the triangles
+    // of a meshlet are contiguous
+    uint32_t firstIndex;
+    uint32_t triangleCount;
+    uint32_t padding[2];
+};
+
+// Full detail plus up to three simplified levels per surface
+constexpr uint32_t kMaxLodLevels = 4;
+
+// Simplified version of a surface, its indices come after the full detail indices of the mesh
+struct SurfaceLod {
+    uint32_t startIndex;
+    uint32_t count;
+    // Relative to the mesh's first meshlet
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+    // Largest distance between the simplified and the full detail surface, in mesh space
+    float error;
+};
+
+// Elements of one page of the mesh arena
+struct ArenaRange {
+    uint32_t page;
+    VmaVirtualAllocation allocation;
+    uint32_t offset;
+    uint32_t count;
+};
+
+// Timeline value that is reached once an upload has landed on the GPU, see UploadService
+using UploadTicket = uint64_t;
+
+// Where a mesh lives in the mesh arena. The buffers are shared with every other mesh on the same pages
 struct GpuMeshBuffers {
-    AllocatedBuffer vertexBuffer;
-    AllocatedBuffer indexBuffer;
+    VkBuffer indexBuffer;
+    // 16 bit for meshes with fewer than 65536 vertices
+    VkIndexType indexType;
     VkDeviceAddress vertexBufferAddress;
+    // Indices of a mesh start at zero, the base vertex moves them to the mesh's vertices
+    int32_t vertexOffset;
+    uint32_t firstIndex;
+    ArenaRange vertexRange;
+    ArenaRange indexRange;
+    VertexFormat vertexFormat;
+    VertexQuantization quantization;
+    // Read by the meshlet cull shader, which copies the visible triangles into a compacted index buffer
+    VkDeviceAddress indexBufferAddress;
+    VkDeviceAddress meshletBufferAddress;
+    ArenaRange meshletRange;
 };
 
+// The world matrix of each instance comes from the instance buffer, indexed by gl_InstanceIndex
 struct GpuDrawPushConstants {
-    glm::mat4 worldMatrix{};
     VkDeviceAddress vertexBuffer{};
+    VkDeviceAddress instanceBuffer{};
+    VertexFormat vertexFormat{};
+    uint32_t padding[3]{};
+    // xyz of the quantization, only used by compact vertices
+    glm::vec4 positionOffset{};
+    glm::vec4 positionScale{};
+};
+
+// Per-object data for GPU culling and indirect drawing, matches ObjectData in object_data.glsl
+struct GpuObjectData {
+    glm::mat4 transform;
+    // w is the bounding sphere radius
+    glm::vec4 boundsOrigin;
+    glm::vec4 boundsExtents;
+    // xyz of the quantization, only used by compact vertices
+    glm::vec4 positionOffset;
+    glm::vec4 positionScale;
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    uint32_t bucket;
+    uint32_t bucketBase;
+    VkDeviceAddress vertexBuffer;
+    int32_t vertexOffset;
+    VertexFormat vertexFormat;
+    // Meshlet culling only: the surface's meshlets, its source indices and where its visible indices go in the compacted index buffer
+    VkDeviceAddress meshletBuffer;
+    VkDeviceAddress indexBuffer;
+    uint32_t meshletCount;
+    uint32_t compactedFirstIndex;
+    VkIndexType indexType;
+    // Single sided material under a transform without non-uniform scale, so back facing meshlets can go
+    uint32_t coneCulling;
+};
+
+struct GpuCullPushConstants {
+    glm::vec4 frustumPlanes[6];
+    VkDeviceAddress objectBuffer;
+    VkDeviceAddress commandBuffer;
+    VkDeviceAddress countBuffer;
+    uint32_t objectCount;
+};
+
+// View the meshlet cull shader tests against, too big for its push constants
+struct GpuCullView {
+    glm::vec4 frustumPlanes[6];
+    glm::vec4 cameraPosition;
+};
+
+struct GpuMeshletCullPushConstants {
+    VkDeviceAddress view;
+    VkDeviceAddress objectBuffer;
+    VkDeviceAddress commandBuffer;
+    VkDeviceAddress countBuffer;
+    VkDeviceAddress compactedIndexBuffer;
+    uint32_t objectCount;
 };
 
 struct GpuSceneData {
@@ -69,6 +200,8 @@ enum class MaterialPass : uint8_t {
 
 struct MaterialPipeline {
     VkPipeline pipeline;
+    // Same state, but reads the object data written for indirect draws instead of push constants
+    VkPipeline indirectPipeline;
     VkPipelineLayout layout;
 };
 
@@ -76,37 +209,33 @@ struct MaterialInstance {
     MaterialPipeline* pipeline;
     VkDescriptorSet materialSet;
     MaterialPass passType;
+    // Back faces are visible, meshlets must not be culled by their normal cone
+    bool doubleSided = false;
 };
 
-class IRenderable {
-public:
-    virtual ~IRenderable() = default;
-
-private:
-    virtual void Draw(const glm::mat4& topMatrix, DrawContext& context) = 0;
-};
-
-class Node : public IRenderable {
+// The transforms live in a TransformHierarchy, a node is a view of one of its entries and must not outlive it
+class Node {
 public:
+    virtual ~Node() = default;
 
     std::weak_ptr<Node> parent_;
     std::vector<std::shared_ptr<Node>> children_;
 
-    glm::mat4 localTransform_{};
-    glm::mat4 worldTransform_{};
-
-    void RefreshTransform(const glm::mat4& parentMatrix) {
-        worldTransform_ = parentMatrix * localTransform_;
-        for (const auto& child : children_) {
-            child->RefreshTransform(worldTransform_);
-        }
-    }
-
-    void Draw(const glm::mat4& topMatrix, DrawContext& context) override {
-        for (const auto& child : children_) {
-            child->Draw(topMatrix, context);
-        }
-    }
+    TransformHierarchy* transforms_ = nullptr;
+    uint32_t transformIndex_ = 0;
+
+    [[nodiscard]] const glm::mat4& GetLocalTransform() const { return transforms_->GetLocalTransform(transformIndex_); }
+
+    // Takes effect with the next TransformHierarchy::Update, which also moves the whole subtree
+    void SetLocalTransform(const glm::mat4& localTransform) const { transforms_->SetLocalTransform(transformIndex_, localTransform); }
+
+    [[nodiscard]] const glm::mat4& GetWorldTransform() const { return transforms_->GetWorldTransform(transformIndex_); }
+
+    // Called by the owner of the hierarchy after an Update changed the world transform
+    virtual void OnTransformChanged() {}
+
+    // Removes whatever the node registered for drawing, the node itself stays
+    virtual void Unregister() {}
 };
 
 
@@ -0,0 +1,423 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "upload_service.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include <fmt/core.h>
+
+#include "core/profiler.h"
+#include "core/utils.h"
+#include "initializers.h"
+
+namespace sirius {
+namespace {
+// Satisfies the texel and optimal copy offset alignment of every format we upload
+constexpr VkDeviceSize kStagingAlignment = 16;
+}
+
+void UploadService::Init(VkDevice device, VmaAllocator allocator, VkQueue transferQueue, uint32_t transferFamily, uint32_t graphicsFamily) {
+    device_ = device;
+    allocator_ = allocator;
+    queue_ = transferQueue;
+    transferFamily_ = transferFamily;
+    graphicsFamily_ = graphicsFamily;
+
+    VkCommandPoolCreateInfo commandPoolInfo = {.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    commandPoolInfo.queueFamilyIndex = transferFamily_;
+    VK_CHECK(vkCreateCommandPool(device_, &commandPoolInfo, nullptr, &commandPool_));
+
+    VkSemaphoreTypeCreateInfo timelineInfo = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+    timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    semaphoreInfo.pNext = &timelineInfo;
+    VK_CHECK(vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &timeline_));
+
+    ring_ = CreateStaging(kStagingRingSize);
+
+    fmt::println("Upload service: using queue family {}{}", transferFamily_, UsesDedicatedQueue() ? " (dedicated transfer)" : " (graphics)");
+}
+
+void UploadService::Destroy() {
+    Wait(lastSubmitted_);
+    Collect();
+
+    vmaDestroyBuffer(allocator_, ring_.buffer, ring_.allocation);
+    vkDestroyCommandPool(device_, commandPool_, nullptr);
+    vkDestroySemaphore(device_, timeline_, nullptr);
+}
+
+UploadTicket UploadService::UploadBuffer(VkBuffer destination, VkDeviceSize offset, std::span<const std::byte> data, bool concurrent) {
+    UploadBatch batch(*this);
+    batch.AddBuffer(destination, offset, data, concurrent);
+    return batch.Submit();
+}
+
+UploadTicket UploadService::UploadImage(const AllocatedImage& image, std::span<const std::byte> data, bool generateMips) {
+    UploadBatch batch(*this);
+    batch.AddImage(image, data, generateMips);
+    return batch.Submit();
+}
+
+bool UploadService::IsComplete(UploadTicket ticket) const {
+    uint64_t value = 0;
+    VK_CHECK(vkGetSemaphoreCounterValue(device_, timeline_, &value));
+    return value >= ticket;
+}
+
+void UploadService::Wait(UploadTicket ticket) const {
+    if (ticket == 0) {
+        return;
+    }
+
+    VkSemaphoreWaitInfo waitInfo = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &timeline_;
+    waitInfo.pValues = &ticket;
+    VK_CHECK(vkWaitSemaphores(device_, &waitInfo, UINT64_MAX));
+}
+
+UploadTicket UploadService::RecordAcquires(VkCommandBuffer cmd) {
+    if (lastAcquired_ == lastSubmitted_) {
+        return 0;
+    }
+
+    if (!pendingBufferAcquires_.empty() || !pendingImageAcquires_.empty()) {
+        VkDependencyInfo dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        dependency.bufferMemoryBarrierCount = static_cast<uint32_t>(pendingBufferAcquires_.size());
+        dependency.pBufferMemoryBarriers = pendingBufferAcquires_.data();
+        dependency.imageMemoryBarrierCount = static_cast<uint32_t>(pendingImageAcquires_.size());
+        dependency.pImageMemoryBarriers = pendingImageAcquires_.data();
+        vkCmdPipelineBarrier2(cmd, &dependency);
+
+        pendingBufferAcquires_.clear();
+        pendingImageAcquires_.clear();
+    }
+
+    for (const MipChain& mipChain : pendingMipChains_) {
+        Utils::GenerateMipmaps(cmd, mipChain.image, mipChain.extent);
+    }
+    pendingMipChains_.clear();
+
+    lastAcquired_ = lastSubmitted_;
+    return lastAcquired_;
+}
+
+void UploadService::Collect() {
+    uint64_t completed = 0;
+    VK_CHECK(vkGetSemaphoreCounterValue(device_, timeline_, &completed));
+
+    while (!inFlight_.empty() && inFlight_.front().ticket <= completed) {
+        Submission& submission = inFlight_.front();
+        for (const AllocatedBuffer& staging : submission.dedicatedStaging) {
+            vmaDestroyBuffer(allocator_, staging.buffer, staging.allocation);
+        }
+        ringTail_ = submission.ringEnd;
+        freeCommandBuffers_.push_back(submission.cmd);
+        inFlight_.pop_front();
+    }
+}
+
+bool UploadService::TryAllocateRing(VkDeviceSize size, VkDeviceSize& offset) {
+    uint64_t position = (ringHead_ + kStagingAlignment - 1) & ~(kStagingAlignment - 1);
+    uint64_t ringOffset = position % kStagingRingSize;
+
+    // Regions never wrap around the end of the ring
+    if (ringOffset + size > kStagingRingSize) {
+        position += kStagingRingSize - ringOffset;
+        ringOffset = 0;
+    }
+
+    if (position + size - ringTail_ > kStagingRingSize) {
+        return false;
+    }
+
+    ringHead_ = position + size;
+    offset = ringOffset;
+    return true;
+}
+
+void UploadService::ReclaimStaging() {
+    if (inFlight_.empty()) {
+        ringHead_ = 0;
+        ringTail_ = 0;
+        return;
+    }
+
+    SRS_PROFILE_SCOPE("UploadService::ReclaimStaging");
+    Wait(inFlight_.front().ticket);
+    Collect();
+}
+
+AllocatedBuffer UploadService::CreateStaging(VkDeviceSize size) const {
+    VkBufferCreateInfo bufferInfo = {.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+    VmaAllocationCreateInfo allocationInfo = {};
+    allocationInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+    allocationInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    AllocatedBuffer staging{};
+    VK_CHECK(vmaCreateBuffer(allocator_, &bufferInfo, &allocationInfo, &staging.buffer, &staging.allocation, &staging.info));
+    return staging;
+}
+
+VkCommandBuffer UploadService::BeginCommands() {
+    Collect();
+
+    VkCommandBuffer cmd;
+    if (freeCommandBuffers_.empty()) {
+        VkCommandBufferAllocateInfo allocateInfo = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocateInfo.commandPool = commandPool_;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandBufferCount = 1;
+        VK_CHECK(vkAllocateCommandBuffers(device_, &allocateInfo, &cmd));
+    } else {
+        cmd = freeCommandBuffers_.back();
+        freeCommandBuffers_.pop_back();
+        VK_CHECK(vkResetCommandBuffer(cmd, 0));
+    }
+
+    const VkCommandBufferBeginInfo beginInfo = init::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+    return cmd;
+}
+
+UploadTicket UploadService::Submit(VkCommandBuffer cmd, std::vector<AllocatedBuffer>&& dedicatedStaging) {
+    VK_CHECK(vkEndCommandBuffer(cmd));
+
+    const UploadTicket ticket = ++lastSubmitted_;
+
+    VkSemaphoreSubmitInfo signalInfo = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+    signalInfo.semaphore = timeline_;
+    signalInfo.value = ticket;
+    signalInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+    VkCommandBufferSubmitInfo cmdInfo = init::command_buffer_submit_info(cmd);
+    const VkSubmitInfo2 submit = init::submit_info(&cmdInfo, &signalInfo, nullptr);
+    VK_CHECK(vkQueueSubmit2(queue_, 1, &submit, VK_NULL_HANDLE));
+
+    inFlight_.push_back({ticket, cmd, ringHead_, std::move(dedicatedStaging)});
+    return ticket;
+}
+
+UploadBatch::UploadBatch(UploadService& service) : service_(service) {
+    assert(!service_.batchOpen_ && "Only one upload batch may be open at a time");
+    service_.batchOpen_ = true;
+}
+
+UploadBatch::~UploadBatch() {
+    Flush();
+    service_.batchOpen_ = false;
+}
+
+void UploadBatch::AddBuffer(VkBuffer destination, VkDeviceSize offset, std::span<const std::byte> data, bool concurrent) {
+    if (data.empty()) {
+        return;
+    }
+
+    const auto [staging, stagingOffset] = Stage(data);
+
+    VkBufferCopy region{};
+    region.srcOffset = stagingOffset;
+    region.dstOffset = offset;
+    region.size = data.size();
+    bufferCopies_.push_back({staging, destination, region});
+
+    if (service_.UsesDedicatedQueue() && !concurrent) {
+        VkBufferMemoryBarrier2 release{.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+        release.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+        release.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        release.srcQueueFamilyIndex = service_.transferFamily_;
+        release.dstQueueFamilyIndex = service_.graphicsFamily_;
+        release.buffer = destination;
+        release.offset = offset;
+        release.size = data.size();
+        bufferReleases_.push_back(release);
+    }
+}
+
+void UploadBatch::AddImage(const AllocatedImage& image, std::span<const std::byte> data, bool generateMips) {
+    const auto [staging, stagingOffset] = Stage(data);
+    imageCopies_.push_back({staging, stagingOffset, image, generateMips, {0}});
+}
+
+void UploadBatch::AddImageLevels(const AllocatedImage& image, std::span<const std::byte> data, std::span<const VkDeviceSize> levelOffsets) {
+    const auto [staging, stagingOffset] = Stage(data);
+    imageCopies_.push_back({staging, stagingOffset, image, false, std::vector(levelOffsets.begin(), levelOffsets.end())});
+}
+
+UploadTicket UploadBatch::Submit() {
+    Flush();
+    return ticket_;
+}
+
+std::pair<VkBuffer, VkDeviceSize> UploadBatch::Stage(std::span<const std::byte> data) {
+    uploadCount_++;
+    uploadedBytes_ += data.size();
+
+    if (data.size() > UploadService::kStagingRingSize) {
+        AllocatedBuffer staging = service_.CreateStaging(data.size());
+        memcpy(staging.info.pMappedData, data.data(), data.size());
+        dedicatedStaging_.push_back(staging);
+        return {staging.buffer, 0};
+    }
+
+    VkDeviceSize offset = 0;
+    while (!service_.TryAllocateRing(data.size(), offset)) {
+        // Our own uploads occupy the ring, submit them so their memory can be reclaimed
+        if (!bufferCopies_.empty() || !imageCopies_.empty()) {
+            Flush();
+        } else {
+            service_.ReclaimStaging();
+        }
+    }
+
+    memcpy(static_cast<std::byte*>(service_.ring_.info.pMappedData) + offset, data.data(), data.size());
+    return {service_.ring_.buffer, offset};
+}
+
+void UploadBatch::Flush() {
+    if (bufferCopies_.empty() && imageCopies_.empty()) {
+        return;
+    }
+    SRS_PROFILE_SCOPE("UploadBatch::Flush");
+
+    VkCommandBuffer cmd = service_.BeginCommands();
+    const bool transferOwnership = service_.UsesDedicatedQueue();
+
+    std::vector<VkImageMemoryBarrier2> toTransfer;
+    toTransfer.reserve(imageCopies_.size());
+    for (const ImageCopy& copy : imageCopies_) {
+        VkImageMemoryBarrier2 barrier{.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+        barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = copy.image.image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+        toTransfer.push_back(barrier);
+    }
+
+    if (!toTransfer.empty()) {
+        VkDependencyInfo dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        dependency.imageMemoryBarrierCount = static_cast<uint32_t>(toTransfer.size());
+        dependency.pImageMemoryBarriers = toTransfer.data();
+        vkCmdPipelineBarrier2(cmd, &dependency);
+    }
+
+    // One copy command per source and destination pair
+    std::ranges::stable_sort(bufferCopies_, [](const BufferCopy& a, const BufferCopy& b) {
+        return a.source != b.source ? a.source < b.source : a.destination < b.destination;
+    });
+
+    std::vector<VkBufferCopy> regions;
+    for (size_t first = 0; first < bufferCopies_.size();) {
+        size_t last = first;
+        regions.clear();
+        while (last < bufferCopies_.size() && bufferCopies_[last].source == bufferCopies_[first].source && bufferCopies_[last].destination == bufferCopies_[first].destination) {
+            regions.push_back(bufferCopies_[last].region);
+            last++;
+        }
+        vkCmdCopyBuffer(cmd, bufferCopies_[first].source, bufferCopies_[first].destination, static_cast<uint32_t>(regions.size()), regions.data());
+        first = last;
+    }
+
+    std::vector<VkBufferImageCopy> imageRegions;
+    for (const ImageCopy& copy : imageCopies_) {
+        imageRegions.clear();
+        for (uint32_t level = 0; level < copy.levelOffsets.size(); level++) {
+            VkBufferImageCopy region = {};
+            region.bufferOffset = copy.sourceOffset + copy.levelOffsets[level];
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = level;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageExtent.width = std::max(copy.image.imageExtent.width >> level, 1u);
+            region.imageExtent.height = std::max(copy.image.imageExtent.height >> level, 1u);
+            region.imageExtent.depth = 1;
+            imageRegions.push_back(region);
+        }
+        vkCmdCopyBufferToImage(cmd, copy.source, copy.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(imageRegions.size()), imageRegions.data());
+    }
+
+    // Release and layout transition in one barrier. On a shared queue it is a plain transition.
+    // Images that still get their mips stay in the transfer layout for the blits
+    std::vector<VkImageMemoryBarrier2> imageReleases = std::move(toTransfer);
+    for (size_t i = 0; i < imageReleases.size(); i++) {
+        VkImageMemoryBarrier2& release = imageReleases[i];
+        const bool generateMips = imageCopies_[i].generateMips;
+        release.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+        release.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        release.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        release.newLayout = generateMips ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        if (transferOwnership) {
+            release.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+            release.dstAccessMask = VK_ACCESS_2_NONE;
+            release.srcQueueFamilyIndex = service_.transferFamily_;
+            release.dstQueueFamilyIndex = service_.graphicsFamily_;
+        } else if (generateMips) {
+            release.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+            release.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        } else {
+            release.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+            release.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
+        }
+
+        if (generateMips) {
+            const VkExtent3D extent = imageCopies_[i].image.imageExtent;
+            service_.pendingMipChains_.push_back({imageCopies_[i].image.image, {extent.width, extent.height}});
+        }
+    }
+
+    VkDependencyInfo releaseDependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    releaseDependency.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferReleases_.size());
+    releaseDependency.pBufferMemoryBarriers = bufferReleases_.data();
+    releaseDependency.imageMemoryBarrierCount = static_cast<uint32_t>(imageReleases.size());
+    releaseDependency.pImageMemoryBarriers = imageReleases.data();
+    if (!bufferReleases_.empty() || !imageReleases.empty()) {
+        vkCmdPipelineBarrier2(cmd, &releaseDependency);
+    }
+
+    // The acquires repeat the transfers, the graphics queue supplies the destination scope
+    if (transferOwnership) {
+        for (VkBufferMemoryBarrier2 acquire : bufferReleases_) {
+            acquire.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+            acquire.srcAccessMask = VK_ACCESS_2_NONE;
+            acquire.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+            acquire.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+            service_.pendingBufferAcquires_.push_back(acquire);
+        }
+        for (VkImageMemoryBarrier2 acquire : imageReleases) {
+            const bool generateMips = acquire.newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            acquire.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+            acquire.srcAccessMask = VK_ACCESS_2_NONE;
+            acquire.dstStageMask = generateMips ? VK_PIPELINE_STAGE_2_TRANSFER_BIT : VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+            acquire.dstAccessMask = generateMips ? VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT : VK_ACCESS_2_SHADER_READ_BIT;
+            service_.pendingImageAcquires_.push_back(acquire);
+        }
+    }
+
+    ticket_ = service_.Submit(cmd, std::move(dedicatedStaging_));
+
+    bufferCopies_.clear();
+    imageCopies_.clear();
+    bufferReleases_.clear();
+    dedicatedStaging_.clear();
+}
+}
@@ -0,0 +1,163 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <deque>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+namespace sirius {
+class UploadBatch;
+
+// Copies data to the GPU on a dedicated transfer queue, without waiting for it. Every submit signals the next value of a timeline semaphore.
+// Resources that are exclusive to one queue family are released by the transfer queue and acquired by the next graphics command buffer
+class UploadService {
+public:
+    // Staging memory shared by all uploads, bigger uploads get a staging buffer of their own
+    static constexpr VkDeviceSize kStagingRingSize = 64ull * 1024 * 1024;
+
+    void Init(VkDevice device, VmaAllocator allocator, VkQueue transferQueue, uint32_t transferFamily, uint32_t graphicsFamily);
+
+    // Waits for every upload in flight
+    void Destroy();
+
+    // Single uploads, each one is a batch of its own. Prefer an UploadBatch for many uploads
+    UploadTicket UploadBuffer(VkBuffer destination, VkDeviceSize offset, std::span<const std::byte> data, bool concurrent = false);
+
+    UploadTicket UploadImage(const AllocatedImage& image, std::span<const std::byte> data, bool generateMips = false);
+
+    [[nodiscard]] bool IsComplete(UploadTicket ticket) const;
+
+    // Blocks the CPU, only needed when the CPU itself depends on the upload
+    void Wait(UploadTicket ticket) const;
+
+    // Records the graphics side of the ownership transfers released so far and generates the requested mip chains. Returns the timeline value the graphics submit has to wait on
+    // before its commands may use the uploads, or 0 if there is nothing new to wait for
+    UploadTicket RecordAcquires(VkCommandBuffer cmd);
+
+    // Frees staging memory and command buffers of completed uploads
+    void Collect();
+
+    [[nodiscard]] VkSemaphore GetTimeline() const { return timeline_; }
+
+    [[nodiscard]] bool UsesDedicatedQueue() const { return transferFamily_ != graphicsFamily_; }
+
+private:
+    friend class UploadBatch;
+
+    struct Submission {
+        UploadTicket ticket;
+        VkCommandBuffer cmd;
+        // Ring position up to which the staging memory is free once the submission completes
+        uint64_t ringEnd;
+        std::vector<AllocatedBuffer> dedicatedStaging;
+    };
+
+    bool TryAllocateRing(VkDeviceSize size, VkDeviceSize& offset);
+
+    // Waits for the oldest submission to free its staging memory, rewinds the ring when nothing is in flight
+    void ReclaimStaging();
+
+    AllocatedBuffer CreateStaging(VkDeviceSize size) const;
+
+    VkCommandBuffer BeginCommands();
+
+    UploadTicket Submit(VkCommandBuffer cmd, std::vector<AllocatedBuffer>&& dedicatedStaging);
+
+    // Images whose first level was uploaded but whose mips are still to be blitted, transfer queues cannot blit
+    struct MipChain {
+        VkImage image;
+        VkExtent2D extent;
+    };
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    VmaAllocator allocator_ = VK_NULL_HANDLE;
+    VkQueue queue_ = VK_NULL_HANDLE;
+    uint32_t transferFamily_ = 0;
+    uint32_t graphicsFamily_ = 0;
+
+    VkCommandPool commandPool_ = VK_NULL_HANDLE;
+    VkSemaphore timeline_ = VK_NULL_HANDLE;
+    UploadTicket lastSubmitted_ = 0;
+    UploadTicket lastAcquired_ = 0;
+
+    // Positions grow forever, the offset in the ring is the position modulo its size
+    AllocatedBuffer ring_{};
+    uint64_t ringHead_ = 0;
+    uint64_t ringTail_ = 0;
+    bool batchOpen_ = false;
+
+    std::deque<Submission> inFlight_;
+    std::vector<VkCommandBuffer> freeCommandBuffers_;
+
+    std::vector<VkBufferMemoryBarrier2> pendingBufferAcquires_;
+    std::vector<VkImageMemoryBarrier2> pendingImageAcquires_;
+    std::vector<MipChain> pendingMipChains_;
+};
+
+// Collects uploads and records them into a single command buffer. Copies into the same buffer become one copy command.
+// Only one batch may be open at a time. If the staging ring runs full the batch is flushed early and continues in a new submit
+class UploadBatch {
+public:
+    explicit UploadBatch(UploadService& service);
+
+    // Submits whatever was not submitted yet
+    ~UploadBatch();
+
+    UploadBatch(const UploadBatch&) = delete;
+    UploadBatch& operator=(const UploadBatch&) = delete;
+
+    // Set concurrent for buffers shared between the graphics and transfer families, they need no ownership transfer
+    void AddBuffer(VkBuffer destination, VkDeviceSize offset, std::span<const std::byte> data, bool concurrent = false);
+
+    // Fills the first mip level, the image ends up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+    // With generateMips the other levels are blitted from it on the graphics queue, by the next RecordAcquires
+    void AddImage(const AllocatedImage& image, std::span<const std::byte> data, bool generateMips = false);
+
+    // Fills the given mip levels, levelOffsets holds the start of each level in data. For block compressed images that come with their mips
+    void AddImageLevels(const AllocatedImage& image, std::span<const std::byte> data, std::span<const VkDeviceSize> levelOffsets);
+
+    // Returns the ticket that covers every upload added so far
+    UploadTicket Submit();
+
+    [[nodiscard]] uint32_t GetUploadCount() const { return uploadCount_; }
+
+    [[nodiscard]] VkDeviceSize GetUploadedBytes() const { return uploadedBytes_; }
+
+private:
+    struct BufferCopy {
+        VkBuffer source;
+        VkBuffer destination;
+        VkBufferCopy region;
+    };
+
+    struct ImageCopy {
+        VkBuffer source;
+        VkDeviceSize sourceOffset;
+        AllocatedImage image;
+        bool generateMips;
+        // Relative to sourceOffset, one per level
+        std::vector<VkDeviceSize> levelOffsets;
+    };
+
+    // Copies the data into staging memory, returns the staging buffer and the offset in it
+    std::pair<VkBuffer, VkDeviceSize> Stage(std::span<const std::byte> data);
+
+    void Flush();
+
+    UploadService& service_;
+    UploadTicket ticket_ = 0;
+    uint32_t uploadCount_ = 0;
+    VkDeviceSize uploadedBytes_ = 0;
+
+    std::vector<BufferCopy> bufferCopies_;
+    std::vector<ImageCopy> imageCopies_;
+    std::vector<VkBufferMemoryBarrier2> bufferReleases_;
+    std::vector<AllocatedBuffer> dedicatedStaging_;
+};
+}
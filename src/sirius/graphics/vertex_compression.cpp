@@ -0,0 +1,107 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#include "vertex_compression.h"
+
+#include <glm/glm.hpp>
+#include <glm/packing.hpp>
+
+namespace sirius {
+namespace {
+// Folds the lower hemisphere over the diagonals, so the unit sphere maps onto [-1, 1]^2
+glm::vec2 EncodeOctahedral(glm::vec3 normal) {
+    const float length = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+    if (length == 0.0f) {
+        return {0.0f, 0.0f};
+    }
+    normal /= length;
+
+    const glm::vec2 encoded{normal.x, normal.y};
+    if (normal.z >= 0.0f) {
+        return encoded;
+    }
+    const glm::vec2 sign{encoded.x >= 0.0f ? 1.0f : -1.0f, encoded.y >= 0.0f ? 1.0f : -1.0f};
+    return (1.0f - glm::abs(glm::vec2{encoded.y, encoded.x})) * sign;
+}
+}
+
+bool CanCompactVertices(std::span<const Vertex> vertices) {
+    for (const Vertex& vertex : vertices) {
+        if (glm::abs(vertex.uvX) > kMaxCompactUv || glm::abs(vertex.uvY) > kMaxCompactUv) {
+            return false;
+        }
+        if (glm::any(glm::lessThan(vertex.color, glm::vec4(0.0f))) || glm::any(glm::greaterThan(vertex.color, glm::vec4(1.0f)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+VertexQuantization CompactVertices(std::span<const Vertex> vertices, std::span<CompactVertex> compacted) {
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+    if (!vertices.empty()) {
+        min = max = vertices[0].position;
+    }
+    for (const Vertex& vertex : vertices) {
+        min = glm::min(min, vertex.position);
+        max = glm::max(max, vertex.position);
+    }
+
+    VertexQuantization quantization{};
+    quantization.offset = min;
+    quantization.scale = max - min;
+    // Flat axes quantize to zero, the scale keeps them at the offset
+    const glm::vec3 inverseScale = glm::vec3{
+        quantization.scale.x > 0.0f ? 1.0f / quantization.scale.x : 0.0f,
+        quantization.scale.y > 0.0f ? 1.0f / quantization.scale.y : 0.0f,
+        quantization.scale.z > 0.0f ? 1.0f / quantization.scale.z : 0.0f,
+    };
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const Vertex& vertex = vertices[i];
+        const glm::vec3 position = (vertex.position - min) * inverseScale;
+        const glm::vec2 normal = EncodeOctahedral(vertex.normal);
+
+        CompactVertex& packed = compacted[i];
+        packed.positionXY = glm::packUnorm2x16(glm::vec2{position.x, position.y});
+        packed.positionZNormal = (glm::packUnorm2x16(glm::vec2{position.z, 0.0f}) & 0xffffu) | (glm::packSnorm4x8(glm::vec4{0.0f, 0.0f, normal.x, normal.y}) & 0xffff0000u);
+        packed.uv = glm::packHalf2x16(glm::vec2{vertex.uvX, vertex.uvY});
+        packed.color = glm::packUnorm4x8(vertex.color);
+    }
+    return quantization;
+}
+
+PackedVertices PackVertices(std::span<const Vertex> vertices, bool compact) {
+    PackedVertices packed{};
+    if (!compact || !CanCompactVertices(vertices)) {
+        const std::span<const std::byte> bytes = std::as_bytes(vertices);
+        packed.bytes.assign(bytes.begin(), bytes.end());
+        return packed;
+    }
+
+    // Compacted straight into the bytes, new storage is aligned for any vertex type
+    packed.format = VertexFormat::kCompact;
+    packed.bytes.resize(vertices.size() * sizeof(CompactVertex));
+    packed.quantization = CompactVertices(vertices, std::span(reinterpret_cast<CompactVertex*>(packed.bytes.data()), vertices.size()));
+    return packed;
+}
+
+PackedIndices PackIndices(std::span<const uint32_t> indices, size_t vertexCount) {
+    PackedIndices packed{};
+    if (vertexCount > UINT16_MAX + 1) {
+        const std::span<const std::byte> bytes = std::as_bytes(indices);
+        packed.bytes.assign(bytes.begin(), bytes.end());
+        return packed;
+    }
+
+    packed.type = VK_INDEX_TYPE_UINT16;
+    packed.bytes.resize(indices.size() * sizeof(uint16_t));
+    auto* shortIndices = reinterpret_cast<uint16_t*>(packed.bytes.data());
+    for (size_t i = 0; i < indices.size(); i++) {
+        shortIndices[i] = static_cast<uint16_t>(indices[i]);
+    }
+    return packed;
+}
+}
@@ -0,0 +1,68 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "types.h"
+
+namespace sirius {
+// UVs beyond this range lose too much precision as half floats, tiling meshes keep full vertices
+constexpr float kMaxCompactUv = 4.0f;
+
+[[nodiscard]] constexpr size_t GetVertexStride(VertexFormat format) {
+    return format == VertexFormat::kCompact ? sizeof(CompactVertex) : sizeof(Vertex);
+}
+
+[[nodiscard]] constexpr size_t GetIndexSize(VkIndexType type) {
+    return type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+// False if quantizing would visibly change the mesh: UVs outside kMaxCompactUv or colors outside [0, 1]
+bool CanCompactVertices(std::span<const Vertex> vertices);
+
+// Quantizes the positions to the box around the vertices, compacted must have room for every vertex
+VertexQuantization CompactVertices(std::span<const Vertex> vertices, std::span<CompactVertex> compacted);
+
+// Vertices in the layout the GPU reads, uploading them is a plain copy. Points into PackedVertices or a mapped scene package
+struct VertexData {
+    VertexFormat format = VertexFormat::kFull;
+    // Only used by compact vertices
+    VertexQuantization quantization{};
+    std::span<const std::byte> bytes;
+
+    [[nodiscard]] uint32_t GetCount() const { return static_cast<uint32_t>(bytes.size() / GetVertexStride(format)); }
+};
+
+struct PackedVertices {
+    VertexFormat format = VertexFormat::kFull;
+    VertexQuantization quantization{};
+    std::vector<std::byte> bytes;
+
+    [[nodiscard]] VertexData GetData() const { return {format, quantization, bytes}; }
+};
+
+// Compacts the vertices if compact is set and CanCompactVertices allows it, otherwise keeps full vertices
+PackedVertices PackVertices(std::span<const Vertex> vertices, bool compact);
+
+// Indices in the layout the GPU reads, relative to the mesh's first vertex
+struct IndexData {
+    VkIndexType type = VK_INDEX_TYPE_UINT32;
+    std::span<const std::byte> bytes;
+
+    [[nodiscard]] uint32_t GetCount() const { return static_cast<uint32_t>(bytes.size() / GetIndexSize(type)); }
+};
+
+struct PackedIndices {
+    VkIndexType type = VK_INDEX_TYPE_UINT32;
+    std::vector<std::byte> bytes;
+
+    [[nodiscard]] IndexData GetData() const { return {type, bytes}; }
+};
+
+// Narrows the indices to 16 bits if the mesh has few enough vertices
+PackedIndices PackIndices(std::span<const uint32_t> indices, size_t vertexCount);
+}
@@ -7,7 +7,12 @@
 #include <ostream>
 #include <stdexcept>
 #include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <filesystem>
 #include <iostream>
+#include <limits>
+#include <ranges>
 #include <set>
 
 #define VMA_IMPLEMENTATION
@@ -21,25 +26,30 @@
 #include <glm/gtx/transform.hpp>
 
 
+#ifdef _WIN32
 #include "window/wndProc.h"
 #include <vulkan/vulkan_win32.h>
+#include "imgui_impl_win32.h"
+#endif
 
 #include "imgui.h"
-#include "imgui_impl_win32.h"
 #include "imgui_impl_vulkan.h"
 
 #include "pipelines.h"
+#include "core/jobs.h"
+#include "core/profiler.h"
 #include "core/utils.h"
 #include "initializers.h"
 
 #include <fmt/core.h>
 
 #include "materials.h"
+#include "vertex_compression.h"
 #include "fastgltf/types.hpp"
 
 
 #ifdef NDEBUG
-const bool enableValidationLayers = false;
+constexpr bool kEnableValidationLayers = false;
 #else
 constexpr bool kEnableValidationLayers = true;
 #endif
@@ -51,38 +61,120 @@ struct SimplePushConstantData {
     alignas(16) glm::vec3 color;
 };
 
-void MeshNode::Draw(const glm::mat4& topMatrix, DrawContext& context) {
-    glm::mat4 nodeMatrix{topMatrix * worldTransform_};
+namespace {
+// Normal cones survive rotation, mirroring and uniform scale, anything else may turn a back facing meshlet towards the viewer
+bool HasUniformScale(const glm::mat4& transform) {
+    const float x = glm::length(glm::vec3(transform[0]));
+    const float y = glm::length(glm::vec3(transform[1]));
+    const float z = glm::length(glm::vec3(transform[2]));
+    return std::max({x, y, z}) - std::min({x, y, z}) <= 1e-3f * std::max({x, y, z});
+}
 
-    for (auto& [startIndex, count, material] : mesh_->surfaces) {
-        RenderObject object{};
-        object.indexCount = count;
-        object.firstIndex = startIndex;
-        object.indexBuffer = mesh_->meshBuffers.indexBuffer.buffer;
-        object.material = &material->data;
-        object.transform = nodeMatrix;
-        object.vertexBufferAddress = mesh_->meshBuffers.vertexBufferAddress;
+// Everything an indirect draw binds once for all of its objects
+bool SharesDrawState(const RenderObject& a, const RenderObject& b) {
+    return a.material->pipeline == b.material->pipeline && a.material->materialSet == b.material->materialSet && a.indexBuffer == b.indexBuffer &&
+           a.indexType == b.indexType;
+}
 
-        context.opaqueRenderObjects.push_back(object);
+float GetMaxScale(const glm::mat4& transform) {
+    return std::max({glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))});
+}
+
+// Coarsest level of the surface whose error stays below the threshold on screen. Measured at the point of the bounding sphere closest to the camera,
+// where the error looks largest
+SurfaceLod SelectLod(const GeoSurface& surface, const glm::mat4& transform, const DrawContext& context) {
+    SurfaceLod selected{surface.startIndex, surface.count, surface.firstMeshlet, surface.meshletCount, 0.0f};
+    if (context.lodPixelScale <= 0.0f || surface.lodCount == 0) {
+        return selected;
+    }
+
+    const float scale = GetMaxScale(transform);
+    const glm::vec3 center = transform * glm::vec4(surface.bounds.origin, 1.0f);
+    const float distance = glm::distance(center, context.cameraPosition) - surface.bounds.sphereRadius * scale;
+    if (distance <= 0.0f) {
+        return selected;
     }
 
-    Node::Draw(topMatrix, context);
+    for (uint32_t i = 0; i < surface.lodCount; i++) {
+        if (surface.lods[i].error * scale / distance * context.lodPixelScale > context.lodErrorThreshold) {
+            break;
+        }
+        selected = surface.lods[i];
+    }
+    return selected;
+}
+}
+
+void MeshNode::Register(DrawRegistry& registry) {
+    Unregister();
+    registry_ = &registry;
+    drawHandle_ = registry.Register(*mesh_, GetWorldTransform());
+}
+
+void MeshNode::Unregister() {
+    if (drawHandle_ != DrawRegistry::kInvalidHandle) {
+        registry_->Unregister(drawHandle_);
+    }
+    drawHandle_ = DrawRegistry::kInvalidHandle;
+    registry_ = nullptr;
+}
+
+void MeshNode::OnTransformChanged() {
+    if (drawHandle_ != DrawRegistry::kInvalidHandle) {
+        registry_->SetTransform(drawHandle_, GetWorldTransform());
+    }
 }
 
-void SrsVkRenderer::Init() {
-    assert(hwndMain != nullptr && "Can't init renderer without window");
+void SrsVkRenderer::Init(const RendererConfig& config) {
+    SRS_PROFILE_THREAD("Main");
+    SRS_PROFILE_SCOPE("SrsVkRenderer::Init");
+    headless_ = config.headless;
+    scenePath_ = config.scenePath;
+    textureCachePath_ = config.textureCachePath;
+    pipelineCachePath_ = config.pipelineCachePath;
+    compactVerticesEnabled_ = config.compactVertices;
+    uint32_t width = config.width;
+    uint32_t height = config.height;
+
+    if (!headless_) {
+#ifdef _WIN32
+        assert(hwndMain != nullptr && "Can't init renderer without window");
+        width = windowWidth;
+        height = windowHeight;
+#else
+        throw std::runtime_error("Windowed rendering is only supported on Win32, use headless mode instead");
+#endif
+        deviceExtensions_.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
+
+    // Asset loading spreads its work over the job system
+    JobSystem::Init();
+
     CreateInstance();
-    CreateSurface();
+    if (!headless_) {
+        CreateSurface();
+    }
     PickPhysicalDevice();
     CreateLogicalDevice();
     InitAllocator();
-    CreateSwapChain(windowWidth, windowHeight);
-    CreateImageViews();
+    if (headless_) {
+        CreateDrawImages(width, height);
+        InitReadback();
+    } else {
+        CreateSwapChain(width, height);
+        CreateImageViews();
+    }
     InitCommandBuffers();
+    InitUploadService();
+    textureTranscoder_.Init(physicalDevice_, enabledFeatures_, textureCachePath_);
     InitSyncObjects();
+    InitGpuProfiler();
     InitDescriptors();
+    pipelineCache_.Init(device_, physicalDevice_, pipelineCachePath_);
     InitPipelines();
-    InitImgui();
+    if (!headless_) {
+        InitImgui();
+    }
     InitDefaultData();
     defaultCamera_.Init();
 
@@ -96,19 +188,40 @@ void SrsVkRenderer::Init() {
 }
 
 void SrsVkRenderer::Draw() {
+    SRS_PROFILE_SCOPE("SrsVkRenderer::Draw");
+    const auto frameStart = std::chrono::high_resolution_clock::now();
+
+    JobSystem::RunMainThreadJobs();
     UpdateScene();
 
-    VK_CHECK(vkWaitForFences(device_, 1, &GetCurrentFrame().renderFence, true, 1000000000));
+    const auto fenceWaitStart = std::chrono::high_resolution_clock::now();
+    {
+        SRS_PROFILE_SCOPE("Wait for frame fence");
+        VK_CHECK(vkWaitForFences(device_, 1, &GetCurrentFrame().renderFence, true, 1000000000));
+    }
+    const auto fenceWait = std::chrono::high_resolution_clock::now() - fenceWaitStart;
 
     GetCurrentFrame().deletionQueue.Flush();
+    // The fences of the earlier slots were waited for by the frames before, so everything up to kFrameOverlap frames ago is complete
+    FlushDeferredDeletions(frameNumber_ - static_cast<int>(kFrameOverlap));
     GetCurrentFrame().frameDescriptors.ClearPools(device_);
+    GetCurrentFrame().uniformAllocator.Reset();
+    uploadService_.Collect();
 
-    uint32_t imageIndex;
+    // The fence guarantees the queries and the copy recorded kFrameOverlap frames ago have landed
+    DeliverFrameStats(frameNumber_ % kFrameOverlap);
+    if (headless_) {
+        DeliverReadback(GetCurrentFrame());
+    }
 
-    VkResult e = vkAcquireNextImageKHR(device_, swapChain_, UINT64_MAX, GetCurrentFrame().acquireSemaphore, VK_NULL_HANDLE, &imageIndex);
-    if (e == VK_ERROR_OUT_OF_DATE_KHR || e == VK_SUBOPTIMAL_KHR) {
-        resizeRequested_ = true;
-        return;
+    uint32_t imageIndex = 0;
+
+    if (!headless_) {
+        VkResult e = vkAcquireNextImageKHR(device_, swapChain_, UINT64_MAX, GetCurrentFrame().acquireSemaphore, VK_NULL_HANDLE, &imageIndex);
+        if (e == VK_ERROR_OUT_OF_DATE_KHR || e == VK_SUBOPTIMAL_KHR) {
+            resizeRequested_ = true;
+            return;
+        }
     }
 
     VK_CHECK(vkResetFences(device_, 1, &GetCurrentFrame().renderFence));
@@ -124,6 +237,25 @@ void SrsVkRenderer::Draw() {
 
     VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
 
+    // Uploads are waited for on the GPU, never on the CPU. The frame after a submit records the acquire barriers and mip blits of all of its
+    // uploads, so it waits for the newest ticket and every later frame can use them without waiting
+    const UploadTicket uploadWait = uploadService_.RecordAcquires(cmd);
+    VkSemaphoreSubmitInfo uploadWaitInfo{};
+    uploadWaitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    uploadWaitInfo.semaphore = uploadService_.GetTimeline();
+    uploadWaitInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    uploadWaitInfo.value = uploadWait;
+
+    FrameData& frame = GetCurrentFrame();
+    frame.stats = {};
+    frame.stats.frameNumber = frameNumber_;
+    frame.stats.visibleSurfaces = mainDrawContext_.visibleSurfaces;
+    frame.stats.culledSurfaces = mainDrawContext_.culledSurfaces;
+    frame.stats.simplifiedSurfaces = mainDrawContext_.simplifiedSurfaces;
+
+    gpuProfiler_.BeginFrame(cmd, frameNumber_ % kFrameOverlap);
+    const uint32_t frameScope = gpuProfiler_.BeginScope(cmd, "Frame");
+
     // transition our main draw image into general layout so we can write into it.
     // we will overwrite it all so we don't care about what the older layout was
     Utils::TransitionFlags beforeComputeFlags{
@@ -135,7 +267,9 @@ void SrsVkRenderer::Draw() {
 
     Utils::TransitionImage(cmd, drawImage_.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, beforeComputeFlags);
 
+    const uint32_t backgroundScope = gpuProfiler_.BeginScope(cmd, "Background");
     DrawBackground(cmd);
+    gpuProfiler_.EndScope(cmd, backgroundScope);
 
     Utils::TransitionFlags beforeGeoDrawFlags{
         .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
@@ -154,7 +288,27 @@ void SrsVkRenderer::Draw() {
     Utils::TransitionImage(cmd, drawImage_.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, beforeGeoDrawFlags);
     Utils::TransitionImage(cmd, depthImage_.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, depthBeforeGeoDrawFlags);
 
+    const uint32_t geometryScope = gpuProfiler_.BeginScope(cmd, "Geometry");
     DrawGeometry(cmd);
+    gpuProfiler_.EndScope(cmd, geometryScope);
+
+    if (headless_) {
+        const uint32_t readbackScope = gpuProfiler_.BeginScope(cmd, "Readback");
+        RecordReadback(cmd);
+        gpuProfiler_.EndScope(cmd, readbackScope);
+        gpuProfiler_.EndScope(cmd, frameScope);
+        VK_CHECK(vkEndCommandBuffer(cmd));
+
+        VkCommandBufferSubmitInfo cmdInfo = init::command_buffer_submit_info(cmd);
+        VkSubmitInfo2 submit = init::submit_info(&cmdInfo, nullptr, uploadWait > 0 ? &uploadWaitInfo : nullptr);
+        VK_CHECK(vkQueueSubmit2(graphicsQueue_, 1, &submit, frame.renderFence));
+
+        frame.stats.cpuFrameMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frameStart - fenceWait).count();
+        frame.statsPending = true;
+
+        frameNumber_++;
+        return;
+    }
 
     //transition the draw image and the swapchain image into their correct transfer layouts
     Utils::TransitionFlags beforeTransferFlagsDraw{
@@ -175,7 +329,9 @@ void SrsVkRenderer::Draw() {
     Utils::TransitionImage(cmd, swapChainImages_[imageIndex], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, beforeTransferFlagsSwapChain);
 
     // execute a copy from the draw image into the swapchain
+    const uint32_t blitScope = gpuProfiler_.BeginScope(cmd, "Blit");
     Utils::CopyImageToImage(cmd, drawImage_.image, swapChainImages_[imageIndex], drawExtent_, swapChainExtent_);
+    gpuProfiler_.EndScope(cmd, blitScope);
 
     Utils::TransitionFlags beforeImguiFlags{
         .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
@@ -186,7 +342,9 @@ void SrsVkRenderer::Draw() {
 
     Utils::TransitionImage(cmd, swapChainImages_[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, beforeImguiFlags);
 
+    const uint32_t imguiScope = gpuProfiler_.BeginScope(cmd, "ImGui");
     DrawImgui(cmd, swapChainImageViews_[imageIndex]);
+    gpuProfiler_.EndScope(cmd, imguiScope);
 
     Utils::TransitionFlags beforePresentFlags{
         .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
@@ -197,6 +355,8 @@ void SrsVkRenderer::Draw() {
     // set swapchain image layout to Present so we can show it on the screen
     Utils::TransitionImage(cmd, swapChainImages_[imageIndex], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, beforePresentFlags);
 
+    gpuProfiler_.EndScope(cmd, frameScope);
+
     //finalize the command buffer (we can no longer add commands, but it can now be executed)
     VK_CHECK(vkEndCommandBuffer(cmd));
 
@@ -206,13 +366,14 @@ void SrsVkRenderer::Draw() {
     cmdBufferInfo.deviceMask = 0;
     cmdBufferInfo.commandBuffer = cmd;
 
-    VkSemaphoreSubmitInfo waitSemaphoreInfo{};
-    waitSemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
-    waitSemaphoreInfo.pNext = nullptr;
-    waitSemaphoreInfo.semaphore = GetCurrentFrame().acquireSemaphore;
-    waitSemaphoreInfo.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR;
-    waitSemaphoreInfo.deviceIndex = 0;
-    waitSemaphoreInfo.value = 1;
+    VkSemaphoreSubmitInfo waitSemaphoreInfos[2]{};
+    waitSemaphoreInfos[0].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    waitSemaphoreInfos[0].pNext = nullptr;
+    waitSemaphoreInfos[0].semaphore = GetCurrentFrame().acquireSemaphore;
+    waitSemaphoreInfos[0].stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR;
+    waitSemaphoreInfos[0].deviceIndex = 0;
+    waitSemaphoreInfos[0].value = 1;
+    waitSemaphoreInfos[1] = uploadWaitInfo;
 
     VkSemaphoreSubmitInfo signalSemaphoreInfo{};
     signalSemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
@@ -226,8 +387,8 @@ void SrsVkRenderer::Draw() {
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
     submitInfo.pNext = nullptr;
 
-    submitInfo.waitSemaphoreInfoCount = 1;
-    submitInfo.pWaitSemaphoreInfos = &waitSemaphoreInfo;
+    submitInfo.waitSemaphoreInfoCount = uploadWait > 0 ? 2 : 1;
+    submitInfo.pWaitSemaphoreInfos = waitSemaphoreInfos;
 
     submitInfo.signalSemaphoreInfoCount = 1;
     submitInfo.pSignalSemaphoreInfos = &signalSemaphoreInfo;
@@ -240,6 +401,9 @@ void SrsVkRenderer::Draw() {
     // _renderFence will now block until the graphic commands finish execution
     VK_CHECK(vkQueueSubmit2(graphicsQueue_, 1, &submitInfo, GetCurrentFrame().renderFence));
 
+    frame.stats.cpuFrameMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frameStart - fenceWait).count();
+    frame.statsPending = true;
+
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.pNext = nullptr;
@@ -279,14 +443,56 @@ void SrsVkRenderer::DrawBackground(VkCommandBuffer cmd) {
 }
 
 void SrsVkRenderer::DrawGeometry(VkCommandBuffer cmd) {
+    SortDrawObjects();
+
+    // The culling dispatch has to be recorded outside of the rendering scope
+    const bool gpuDriven = gpuDrivenEnabled_ && drawIndirectCountSupported_;
+    if (gpuDriven) {
+        const uint32_t cullingScope = gpuProfiler_.BeginScope(cmd, "Culling");
+        RecordGpuCulling(cmd);
+        gpuProfiler_.EndScope(cmd, cullingScope);
+    } else {
+        BuildDrawBatches();
+    }
+
+    const FrameUniformAllocator::Allocation sceneDataAllocation{GetCurrentFrame().uniformAllocator.Push(sceneData_)};
+
+    VkDescriptorSet globalDescriptor{GetCurrentFrame().frameDescriptors.Allocate(device_, sceneDataDescriptorLayout_)};
+
+    DescriptorWriter writer;
+    writer.WriteBuffer(0, sceneDataAllocation.buffer, sizeof(GpuSceneData), sceneDataAllocation.offset, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+    writer.UpdateSet(device_, globalDescriptor);
+
     VkRenderingAttachmentInfo colorAttachment = init::attachment_info(drawImage_.imageView, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
     VkRenderingAttachmentInfo depthAttachment = init::depth_attachment_info(depthImage_.imageView, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
 
-    const VkRenderingInfo renderingInfo = init::rendering_info(drawExtent_, &colorAttachment, &depthAttachment);
+    VkRenderingInfo renderingInfo = init::rendering_info(drawExtent_, &colorAttachment, &depthAttachment);
+
+    // With secondaries the rendering scope may only contain vkCmdExecuteCommands
+    const uint32_t chunkCount = gpuDriven ? 0 : GetRecordingChunkCount();
+    if (chunkCount > 0) {
+        renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+        vkCmdBeginRendering(cmd, &renderingInfo);
+        DrawDirectParallel(cmd, globalDescriptor, chunkCount);
+        vkCmdEndRendering(cmd);
+        return;
+    }
+
     vkCmdBeginRendering(cmd, &renderingInfo);
 
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, meshPipeline_);
+    SetViewportAndScissor(cmd);
+
+    if (gpuDriven) {
+        DrawIndirect(cmd, globalDescriptor);
+    } else {
+        DrawDirect(cmd, globalDescriptor, drawBatches_, GetCurrentFrame().stats);
+    }
+
+    vkCmdEndRendering(cmd);
+}
 
+void SrsVkRenderer::SetViewportAndScissor(VkCommandBuffer cmd) const {
     VkViewport viewport = {};
     viewport.x = 0;
     viewport.y = 0;
@@ -301,69 +507,516 @@ void SrsVkRenderer::DrawGeometry(VkCommandBuffer cmd) {
     scissor.extent.width = drawExtent_.width;
     scissor.extent.height = drawExtent_.height;
     vkCmdSetScissor(cmd, 0, 1, &scissor);
+}
 
-    AllocatedBuffer sceneDataBuffer{CreateBuffer(sizeof(GpuSceneData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU)};
+uint32_t SrsVkRenderer::GetRecordingChunkCount() const {
+    if (!parallelRecordingEnabled_ || parallelRecorder_.GetThreadCount() < 2) {
+        return 0;
+    }
 
-    GetCurrentFrame().deletionQueue.PushFunction([this, sceneDataBuffer] { DestroyBuffer(sceneDataBuffer); });
-    auto* sceneUniformData{static_cast<GpuSceneData*>(sceneDataBuffer.allocation->GetMappedData())};
-    *sceneUniformData = sceneData_;
+    const auto drawCount = static_cast<uint32_t>(drawBatches_.size());
+    const uint32_t chunkCount = std::min(drawCount / kMinDrawsPerRecordingChunk, parallelRecorder_.GetThreadCount());
+    return chunkCount > 1 ? chunkCount : 0;
+}
 
-    VkDescriptorSet globalDescriptor{GetCurrentFrame().frameDescriptors.Allocate(device_, sceneDataDescriptorLayout_)};
+void SrsVkRenderer::DrawDirectParallel(VkCommandBuffer cmd, VkDescriptorSet globalDescriptor, uint32_t chunkCount) {
+    SRS_PROFILE_SCOPE("SrsVkRenderer::DrawDirectParallel");
 
-    DescriptorWriter writer;
-    writer.WriteBuffer(0, sceneDataBuffer.buffer, sizeof(GpuSceneData), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-    writer.UpdateSet(device_, globalDescriptor);
+    VkCommandBufferInheritanceRenderingInfo renderingInheritance{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO};
+    renderingInheritance.colorAttachmentCount = 1;
+    renderingInheritance.pColorAttachmentFormats = &drawImage_.imageFormat;
+    renderingInheritance.depthAttachmentFormat = depthImage_.imageFormat;
+    renderingInheritance.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkCommandBufferInheritanceInfo inheritance{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+    inheritance.pNext = &renderingInheritance;
+
+    // Chunks are contiguous runs of the sorted draws, so each one keeps the bind savings of the sort
+    const auto drawCount = static_cast<uint32_t>(drawBatches_.size());
+    chunkStats_.assign(chunkCount, FrameStats{});
+
+    const std::span<const VkCommandBuffer> secondaries = parallelRecorder_.Record(frameNumber_ % kFrameOverlap, chunkCount, inheritance, [&](VkCommandBuffer chunkCmd, uint32_t chunk) {
+        const uint32_t first = drawCount * chunk / chunkCount;
+        const uint32_t last = drawCount * (chunk + 1) / chunkCount;
+
+        // Secondaries inherit no dynamic state from the primary
+        SetViewportAndScissor(chunkCmd);
+        DrawDirect(chunkCmd, globalDescriptor, std::span(drawBatches_).subspan(first, last - first), chunkStats_[chunk]);
+    });
+
+    vkCmdExecuteCommands(cmd, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+
+    FrameStats& stats = GetCurrentFrame().stats;
+    for (const FrameStats& chunk : chunkStats_) {
+        stats.drawCount += chunk.drawCount;
+        stats.instanceCount += chunk.instanceCount;
+        stats.triangleCount += chunk.triangleCount;
+        stats.pipelineBinds += chunk.pipelineBinds;
+        stats.descriptorSetBinds += chunk.descriptorSetBinds;
+        stats.indexBufferBinds += chunk.indexBufferBinds;
+    }
+}
+
+void SrsVkRenderer::DrawDirect(VkCommandBuffer cmd, VkDescriptorSet globalDescriptor, std::span<const DrawBatch> batches, FrameStats& stats) {
+    MaterialPipeline* lastPipeline = nullptr;
+    VkDescriptorSet lastMaterialSet = VK_NULL_HANDLE;
+    VkBuffer lastIndexBuffer = VK_NULL_HANDLE;
+
+    for (const auto& [objectIndex, firstInstance, instanceCount] : batches) {
+        const RenderObject& object = drawRegistry_.GetObjects()[objectIndex];
+        const MaterialInstance* material = object.material;
+
+        if (material->pipeline != lastPipeline) {
+            lastPipeline = material->pipeline;
+            // A new layout may disturb both sets, so they are rebound with the pipeline
+            lastMaterialSet = VK_NULL_HANDLE;
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, material->pipeline->pipeline);
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, material->pipeline->layout, 0, 1, &globalDescriptor, 0, nullptr);
+            stats.pipelineBinds++;
+            stats.descriptorSetBinds++;
+        }
 
-    for (const auto& [indexCount, firstIndex, indexBuffer, material, transform, vertexBufferAddress] : mainDrawContext_.opaqueRenderObjects) {
-        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, material->pipeline->pipeline);
-        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, material->pipeline->layout, 0, 1, &globalDescriptor, 0, nullptr);
-        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, material->pipeline->layout, 1, 1, &material->materialSet, 0, nullptr);
+        if (material->materialSet != lastMaterialSet) {
+            lastMaterialSet = material->materialSet;
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, material->pipeline->layout, 1, 1, &material->materialSet, 0, nullptr);
+            stats.descriptorSetBinds++;
+        }
 
-        vkCmdBindIndexBuffer(cmd, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+        if (object.indexBuffer != lastIndexBuffer) {
+            lastIndexBuffer = object.indexBuffer;
+            vkCmdBindIndexBuffer(cmd, object.indexBuffer, 0, object.indexType);
+            stats.indexBufferBinds++;
+        }
 
         GpuDrawPushConstants pushConstants;
-        pushConstants.vertexBuffer = vertexBufferAddress;
-        pushConstants.worldMatrix = transform;
+        pushConstants.vertexBuffer = object.vertexBufferAddress;
+        pushConstants.instanceBuffer = instanceBufferAddress_;
+        pushConstants.vertexFormat = object.vertexFormat;
+        pushConstants.positionOffset = glm::vec4(object.quantization.offset, 0.0f);
+        pushConstants.positionScale = glm::vec4(object.quantization.scale, 0.0f);
         vkCmdPushConstants(cmd, material->pipeline->layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(GpuDrawPushConstants), &pushConstants);
 
-        vkCmdDrawIndexed(cmd, indexCount, 1, firstIndex, 0, 0);
+        vkCmdDrawIndexed(cmd, object.indexCount, instanceCount, object.firstIndex, object.vertexOffset, firstInstance);
+
+        stats.drawCount++;
+        stats.instanceCount += instanceCount;
+        stats.triangleCount += static_cast<uint64_t>(object.indexCount / 3) * instanceCount;
     }
+}
 
-    vkCmdEndRendering(cmd);
+void SrsVkRenderer::RecordGpuCulling(VkCommandBuffer cmd) {
+    SRS_PROFILE_SCOPE("SrsVkRenderer::RecordGpuCulling");
+    FrameData& frame = GetCurrentFrame();
+    const std::span<const RenderObject> objects = drawRegistry_.GetObjects();
+
+    // Sorted draws that share pipeline, material set and index buffer end up in one indirect draw. The key above the depth bits groups them,
+    // the state itself is compared as well since handles that did not fit their key field share an id
+    indirectBuckets_.clear();
+    for (uint32_t i = 0; i < drawSortEntries_.size(); i++) {
+        if (i == 0 || drawSortEntries_[i].key >> 16 != drawSortEntries_[i - 1].key >> 16 ||
+            !SharesDrawState(objects[drawSortEntries_[i].index], objects[drawSortEntries_[i - 1].index])) {
+            indirectBuckets_.push_back({i, 0});
+        }
+        indirectBuckets_.back().count++;
+    }
+
+    const auto objectCount = static_cast<uint32_t>(drawSortEntries_.size());
+    if (objectCount == 0) {
+        return;
+    }
+    EnsureIndirectCapacity(frame, objectCount);
+
+    // Objects are stored in sorted order, so each bucket's commands start at its first object
+    auto* objectData = static_cast<GpuObjectData*>(frame.objectBuffer.info.pMappedData);
+    uint32_t compactedIndexCount = 0;
+    for (uint32_t bucket = 0; bucket < indirectBuckets_.size(); bucket++) {
+        const IndirectBucket& range = indirectBuckets_[bucket];
+        for (uint32_t i = range.firstEntry; i < range.firstEntry + range.count; i++) {
+            const RenderObject& object = objects[drawSortEntries_[i].index];
+
+            GpuObjectData& data = objectData[i];
+            data.transform = object.transform;
+            data.boundsOrigin = glm::vec4(object.bounds.origin, object.bounds.sphereRadius);
+            data.boundsExtents = glm::vec4(object.bounds.extents, 0.0f);
+            data.positionOffset = glm::vec4(object.quantization.offset, 0.0f);
+            data.positionScale = glm::vec4(object.quantization.scale, 0.0f);
+            data.indexCount = object.indexCount;
+            data.firstIndex = object.firstIndex;
+            data.bucket = bucket;
+            data.bucketBase = range.firstEntry;
+            data.vertexBuffer = object.vertexBufferAddress;
+            data.vertexOffset = object.vertexOffset;
+            data.vertexFormat = object.vertexFormat;
+            data.meshletBuffer = object.meshletBufferAddress;
+            data.indexBuffer = object.indexBufferAddress;
+            data.meshletCount = object.meshletCount;
+            data.compactedFirstIndex = compactedIndexCount;
+            data.indexType = object.indexType;
+            data.coneCulling = !object.material->doubleSided && HasUniformScale(object.transform);
+            compactedIndexCount += object.indexCount;
+
+            // The GPU decides how many of these get drawn, the triangles are an upper bound
+            frame.stats.triangleCount += object.indexCount / 3;
+        }
+    }
+
+    vkCmdFillBuffer(cmd, frame.drawCountBuffer.buffer, 0, indirectBuckets_.size() * sizeof(uint32_t), 0);
+
+    VkMemoryBarrier2 clearBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    clearBarrier.srcStageMask = VK_PIPELINE_STAGE_2_CLEAR_BIT;
+    clearBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    clearBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+
+    VkDependencyInfo clearDependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    clearDependency.memoryBarrierCount = 1;
+    clearDependency.pMemoryBarriers = &clearBarrier;
+    vkCmdPipelineBarrier2(cmd, &clearDependency);
+
+    std::array<glm::vec4, 6> frustumPlanes{};
+    if (mainDrawContext_.frustum.has_value()) {
+        frustumPlanes = mainDrawContext_.frustum->planes;
+    } else {
+        // Planes every object is in front of
+        frustumPlanes.fill(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    }
+
+    if (meshletCullingEnabled_) {
+        EnsureCompactedIndexCapacity(frame, compactedIndexCount);
+
+        GpuCullView view{};
+        std::ranges::copy(frustumPlanes, view.frustumPlanes);
+        view.cameraPosition = glm::vec4(defaultCamera_.position_, 1.0f);
+        const FrameUniformAllocator::Allocation viewAllocation = frame.uniformAllocator.Push(view);
+
+        GpuMeshletCullPushConstants pushConstants{};
+        pushConstants.view = GetBufferAddress(viewAllocation.buffer) + viewAllocation.offset;
+        pushConstants.objectBuffer = GetBufferAddress(frame.objectBuffer.buffer);
+        pushConstants.commandBuffer = GetBufferAddress(frame.indirectBuffer.buffer);
+        pushConstants.countBuffer = GetBufferAddress(frame.drawCountBuffer.buffer);
+        pushConstants.compactedIndexBuffer = GetBufferAddress(frame.compactedIndexBuffer.buffer);
+        pushConstants.objectCount = objectCount;
+
+        // One workgroup per object, folded into rows to stay below the dispatch size limit
+        const uint32_t groupsX = std::min(objectCount, kMaxCullGroupsPerRow);
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, meshletCullPipeline_);
+        vkCmdPushConstants(cmd, meshletCullPipelineLayout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GpuMeshletCullPushConstants), &pushConstants);
+        vkCmdDispatch(cmd, groupsX, (objectCount + groupsX - 1) / groupsX, 1);
+    } else {
+        GpuCullPushConstants pushConstants{};
+        std::ranges::copy(frustumPlanes, pushConstants.frustumPlanes);
+        pushConstants.objectBuffer = GetBufferAddress(frame.objectBuffer.buffer);
+        pushConstants.commandBuffer = GetBufferAddress(frame.indirectBuffer.buffer);
+        pushConstants.countBuffer = GetBufferAddress(frame.drawCountBuffer.buffer);
+        pushConstants.objectCount = objectCount;
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline_);
+        vkCmdPushConstants(cmd, cullPipelineLayout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GpuCullPushConstants), &pushConstants);
+        vkCmdDispatch(cmd, (objectCount + 63) / 64, 1, 1);
+    }
+
+    VkMemoryBarrier2 cullBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    cullBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    cullBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    cullBarrier.dstStageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_INDEX_READ_BIT;
+
+    VkDependencyInfo cullDependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    cullDependency.memoryBarrierCount = 1;
+    cullDependency.pMemoryBarriers = &cullBarrier;
+    vkCmdPipelineBarrier2(cmd, &cullDependency);
+}
+
+void SrsVkRenderer::DrawIndirect(VkCommandBuffer cmd, VkDescriptorSet globalDescriptor) {
+    FrameData& frame = GetCurrentFrame();
+    FrameStats& stats = frame.stats;
+    const VkDeviceAddress objectBufferAddress = drawSortEntries_.empty() ? 0 : GetBufferAddress(frame.objectBuffer.buffer);
+
+    MaterialPipeline* lastPipeline = nullptr;
+    VkDescriptorSet lastMaterialSet = VK_NULL_HANDLE;
+    VkBuffer lastIndexBuffer = VK_NULL_HANDLE;
+
+    for (uint32_t bucket = 0; bucket < indirectBuckets_.size(); bucket++) {
+        const IndirectBucket& range = indirectBuckets_[bucket];
+        // Every object of the bucket shares this state
+        const RenderObject& first = drawRegistry_.GetObjects()[drawSortEntries_[range.firstEntry].index];
+        const MaterialInstance* material = first.material;
+
+        if (material->pipeline != lastPipeline) {
+            lastPipeline = material->pipeline;
+            lastMaterialSet = VK_NULL_HANDLE;
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, material->pipeline->indirectPipeline);
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, material->pipeline->layout, 0, 1, &globalDescriptor, 0, nullptr);
+            vkCmdPushConstants(cmd, material->pipeline->layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(VkDeviceAddress), &objectBufferAddress);
+            stats.pipelineBinds++;
+            stats.descriptorSetBinds++;
+        }
+
+        if (material->materialSet != lastMaterialSet) {
+            lastMaterialSet = material->materialSet;
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, material->pipeline->layout, 1, 1, &material->materialSet, 0, nullptr);
+            stats.descriptorSetBinds++;
+        }
+
+        // Meshlet culling leaves every object's visible triangles in the compacted index buffer
+        const VkBuffer indexBuffer = meshletCullingEnabled_ ? frame.compactedIndexBuffer.buffer : first.indexBuffer;
+        if (indexBuffer != lastIndexBuffer) {
+            lastIndexBuffer = indexBuffer;
+            vkCmdBindIndexBuffer(cmd, indexBuffer, 0, meshletCullingEnabled_ ? VK_INDEX_TYPE_UINT32 : first.indexType);
+            stats.indexBufferBinds++;
+        }
+
+        vkCmdDrawIndexedIndirectCount(cmd, frame.indirectBuffer.buffer, range.firstEntry * sizeof(VkDrawIndexedIndirectCommand), frame.drawCountBuffer.buffer,
+                                      bucket * sizeof(uint32_t), range.count, sizeof(VkDrawIndexedIndirectCommand));
+
+        stats.drawCount++;
+    }
+}
+
+void SrsVkRenderer::EnsureIndirectCapacity(FrameData& frame, uint32_t objectCount) {
+    if (objectCount <= frame.indirectCapacity) {
+        return;
+    }
+
+    const uint32_t capacity = std::max(objectCount, frame.indirectCapacity * 2);
+
+    // The frame fence has signaled, nothing on the GPU uses this frame's buffers anymore
+    if (frame.indirectCapacity > 0) {
+        DestroyIndirectBuffers(frame);
+    }
+    frame.indirectCapacity = capacity;
+
+    frame.objectBuffer = CreateBuffer(frame.indirectCapacity * sizeof(GpuObjectData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                      VMA_MEMORY_USAGE_CPU_TO_GPU);
+    frame.indirectBuffer = CreateBuffer(frame.indirectCapacity * sizeof(VkDrawIndexedIndirectCommand),
+                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                        VMA_MEMORY_USAGE_GPU_ONLY);
+    // One count per bucket, there are never more buckets than objects
+    frame.drawCountBuffer = CreateBuffer(frame.indirectCapacity * sizeof(uint32_t),
+                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                         VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+}
+
+void SrsVkRenderer::EnsureCompactedIndexCapacity(FrameData& frame, uint32_t indexCount) {
+    if (indexCount <= frame.compactedIndexCapacity) {
+        return;
+    }
+
+    // The frame fence has signaled, nothing on the GPU uses this frame's buffer anymore
+    if (frame.compactedIndexCapacity > 0) {
+        DestroyBuffer(frame.compactedIndexBuffer);
+    }
+    frame.compactedIndexCapacity = std::max(indexCount, frame.compactedIndexCapacity * 2);
+    frame.compactedIndexBuffer = CreateBuffer(frame.compactedIndexCapacity * sizeof(uint32_t),
+                                              VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                              VMA_MEMORY_USAGE_GPU_ONLY);
+}
+
+void SrsVkRenderer::DestroyIndirectBuffers(FrameData& frame) const {
+    DestroyBuffer(frame.objectBuffer);
+    DestroyBuffer(frame.indirectBuffer);
+    DestroyBuffer(frame.drawCountBuffer);
+    frame.indirectCapacity = 0;
+}
+
+VkDeviceAddress SrsVkRenderer::GetBufferAddress(VkBuffer buffer) const {
+    VkBufferDeviceAddressInfo deviceAddressInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO};
+    deviceAddressInfo.buffer = buffer;
+    return vkGetBufferDeviceAddress(device_, &deviceAddressInfo);
+}
+
+void SrsVkRenderer::SortDrawObjects() {
+    SRS_PROFILE_SCOPE("SrsVkRenderer::SortDrawObjects");
+    DrawContext& context = mainDrawContext_;
+    const std::span<const RenderObject> objects = drawRegistry_.GetObjects();
+    const glm::vec3 cameraPosition = defaultCamera_.position_;
+
+    // Nothing moved and the camera is the same as last frame, and with them the order
+    if (!context.visibilityRebuilt && context.changedObjects.empty()) {
+        return;
+    }
+
+    if (context.visibilityRebuilt) {
+        drawSortEntries_.clear();
+    } else {
+        std::erase_if(drawSortEntries_, [&](const DrawSortEntry& entry) { return context.visibility[entry.index].changed; });
+    }
+
+    drawSortChanged_.clear();
+    for (const uint32_t i : context.changedObjects) {
+        context.visibility[i].changed = false;
+        if (!context.visibility[i].visible) {
+            continue;
+        }
+
+        const RenderObject& object = objects[i];
+        const float viewDepth = glm::length(glm::vec3(object.transform[3]) - cameraPosition);
+
+        const uint64_t key = BuildSortKey(pipelineIds_.Get(object.material->pipeline), materialIds_.Get(object.material->materialSet),
+                                          indexBufferIds_.Get(object.indexBuffer), viewDepth);
+        drawSortChanged_.push_back({key, i});
+    }
+    context.changedObjects.clear();
+    context.visibilityRebuilt = false;
+
+    // The kept entries are still in order, only the new ones need sorting before both are merged
+    RadixSort(drawSortChanged_, drawSortScratch_);
+    const auto keptCount = static_cast<std::ptrdiff_t>(drawSortEntries_.size());
+    drawSortEntries_.insert(drawSortEntries_.end(), drawSortChanged_.begin(), drawSortChanged_.end());
+    std::inplace_merge(drawSortEntries_.begin(), drawSortEntries_.begin() + keptCount, drawSortEntries_.end(),
+                       [](const DrawSortEntry& a, const DrawSortEntry& b) { return a.key < b.key; });
+}
+
+void SrsVkRenderer::BuildDrawBatches() {
+    SRS_PROFILE_SCOPE("SrsVkRenderer::BuildDrawBatches");
+    const std::span<const RenderObject> objects = drawRegistry_.GetObjects();
+
+    drawBatches_.clear();
+    drawBatchOfEntry_.resize(drawSortEntries_.size());
+    for (uint32_t i = 0; i < drawSortEntries_.size(); i++) {
+        const uint32_t objectIndex = drawSortEntries_[i].index;
+
+        // Pipeline, material set and index buffer sit above the depth bits, a new run can never continue a batch of the previous one
+        if (i == 0 || drawSortEntries_[i].key >> 16 != drawSortEntries_[i - 1].key >> 16) {
+            drawBatchLookup_.clear();
+        }
+
+        if (!instancingEnabled_) {
+            drawBatchOfEntry_[i] = static_cast<uint32_t>(drawBatches_.size());
+            drawBatches_.push_back({objectIndex, 0, 1});
+            continue;
+        }
+
+        const RenderObject& object = objects[objectIndex];
+        const InstanceKey key{object.material, object.indexBuffer, object.vertexBufferAddress, object.firstIndex, object.indexCount, object.vertexOffset};
+        const auto [batch, inserted] = drawBatchLookup_.try_emplace(key, static_cast<uint32_t>(drawBatches_.size()));
+        if (inserted) {
+            drawBatches_.push_back({objectIndex, 0, 0});
+        }
+        drawBatches_[batch->second].instanceCount++;
+        drawBatchOfEntry_[i] = batch->second;
+    }
+
+    uint32_t instanceCount = 0;
+    for (DrawBatch& batch : drawBatches_) {
+        batch.firstInstance = instanceCount;
+        instanceCount += batch.instanceCount;
+        batch.instanceCount = 0;
+    }
+
+    instanceBufferAddress_ = 0;
+    if (instanceCount == 0) {
+        return;
+    }
+
+    // Counted up again while the transforms are placed, so the batch order is the sorted order of their instances
+    const FrameUniformAllocator::Allocation instances = GetCurrentFrame().uniformAllocator.Allocate(instanceCount * sizeof(glm::mat4));
+    auto* transforms = static_cast<glm::mat4*>(instances.data);
+    for (uint32_t i = 0; i < drawSortEntries_.size(); i++) {
+        DrawBatch& batch = drawBatches_[drawBatchOfEntry_[i]];
+        transforms[batch.firstInstance + batch.instanceCount++] = objects[drawSortEntries_[i].index].transform;
+    }
+    instanceBufferAddress_ = GetBufferAddress(instances.buffer) + instances.offset;
 }
 
 void SrsVkRenderer::UpdateScene() {
+    SRS_PROFILE_SCOPE("SrsVkRenderer::UpdateScene");
     drawExtent_.width = drawImage_.imageExtent.width;
     drawExtent_.height = drawImage_.imageExtent.height;
 
     defaultCamera_.Update();
 
-    mainDrawContext_.opaqueRenderObjects.clear();
-
-    // loadedNodes_.at("Suzanne")->Draw(glm::mat4{1.0f}, mainDrawContext_);
-    // for (int x = -3; x < 4; x++) {
-    //     for (int y = -3; y < 4; y++) {
-    //         for (int z = -3; z < 4; z++) {
-    //             if (x == 0 && y == 0 && z == 0) {continue;}
-    //             glm::mat4 scale = glm::scale(glm::vec3{0.2});
-    //             glm::mat4 translation = glm::translate(glm::vec3{x * 3, y * 3, z * 3});
-    //
-    //             loadedNodes_["Cube"]->Draw(translation * scale, mainDrawContext_);
-    //         }
-    //     }
-    //
-    // }
-
     sceneData_.viewMatrix = defaultCamera_.GetViewMatrix();
     sceneData_.projectionMatrix = glm::perspectiveRH_ZO(glm::radians(70.0f), static_cast<float>(drawExtent_.width) / static_cast<float>(drawExtent_.height), 10000.0f, 0.1f);
     sceneData_.projectionMatrix[1][1] *= -1;
     sceneData_.viewProjectionMatrix = sceneData_.projectionMatrix * sceneData_.viewMatrix;
 
+    if (frustumCullingEnabled_) {
+        mainDrawContext_.frustum = Frustum::FromMatrix(sceneData_.viewProjectionMatrix);
+    } else {
+        mainDrawContext_.frustum.reset();
+    }
+
+    // An error of one unit at distance one covers half the viewport height times the focal length in pixels
+    mainDrawContext_.cameraPosition = defaultCamera_.position_;
+    mainDrawContext_.lodPixelScale = lodEnabled_ ? 0.5f * static_cast<float>(drawExtent_.height) * std::abs(sceneData_.projectionMatrix[1][1]) : 0.0f;
+    mainDrawContext_.lodErrorThreshold = lodErrorPixels_;
+
     sceneData_.ambientColor = glm::vec4(0.1f);
     sceneData_.sunlightColor = glm::vec4(1.0f);
     sceneData_.sunlightDirection = glm::vec4(0, 1, 0.5f, 1.0f);
 
-    loadedScenes_.at("structure")->Draw(glm::mat4{ 1.0f }, mainDrawContext_);
+    // Only moved nodes touch the draw registry
+    for (const auto& scene : loadedScenes_ | std::views::values) {
+        scene->UpdateTransforms();
+    }
+
+    CollectVisibleObjects();
+}
+
+void SrsVkRenderer::CollectVisibleObjects() {
+    SRS_PROFILE_SCOPE("SrsVkRenderer::CollectVisibleObjects");
+    DrawContext& context = mainDrawContext_;
+    const VisibilityInputs inputs{sceneData_.viewProjectionMatrix, context.frustum.has_value(), context.lodPixelScale, context.lodErrorThreshold,
+                                  drawRegistry_.GetLayoutVersion()};
+
+    if (visibilityInputs_ != inputs) {
+        visibilityInputs_ = inputs;
+        context.visibility.assign(drawRegistry_.GetCount(), {});
+        context.changedObjects.clear();
+        context.visibilityRebuilt = true;
+        context.visibleSurfaces = 0;
+        context.culledSurfaces = 0;
+        context.simplifiedSurfaces = 0;
+
+        for (const DrawGroup& group : drawRegistry_.GetGroups()) {
+            CollectVisibleGroup(group);
+        }
+    } else {
+        // Only the moved objects are tested again, the rest of the visible set stays as it is
+        for (const DrawHandle handle : drawRegistry_.GetMovedGroups()) {
+            const DrawGroup& group = drawRegistry_.GetGroup(handle);
+            for (const uint32_t i : group.objects) {
+                const ObjectVisibility& previous = context.visibility[i];
+                context.visibleSurfaces -= previous.visible;
+                context.culledSurfaces -= !previous.visible;
+                context.simplifiedSurfaces -= previous.simplified;
+            }
+            CollectVisibleGroup(group);
+        }
+    }
+    drawRegistry_.ClearMoved();
+}
+
+void SrsVkRenderer::CollectVisibleGroup(const DrawGroup& group) {
+    DrawContext& context = mainDrawContext_;
+    const std::span<const RenderObject> objects = drawRegistry_.GetObjects();
+
+    // A single object has the bounds of its group
+    const bool groupVisible = !context.frustum.has_value() || context.frustum->IsVisible(group.worldBounds);
+    const bool testObjects = groupVisible && context.frustum.has_value() && group.objects.size() > 1;
+
+    for (const uint32_t i : group.objects) {
+        ObjectVisibility& visibility = context.visibility[i];
+        if (!visibility.changed) {
+            visibility.changed = true;
+            context.changedObjects.push_back(i);
+        }
+
+        visibility.visible = groupVisible && (!testObjects || context.frustum->IsVisible(drawRegistry_.GetWorldBounds(i)));
+        visibility.simplified = false;
+        if (!visibility.visible) {
+            context.culledSurfaces++;
+            continue;
+        }
+        context.visibleSurfaces++;
+
+        const GeoSurface& surface = drawRegistry_.GetSurface(i);
+        const SurfaceLod lod = SelectLod(surface, objects[i].transform, context);
+        visibility.simplified = lod.count != surface.count;
+        context.simplifiedSurfaces += visibility.simplified;
+        drawRegistry_.SetLod(i, lod);
+    }
 }
 
 AllocatedBuffer SrsVkRenderer::CreateBuffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage) {
@@ -390,14 +1043,20 @@ void SrsVkRenderer::DestroyBuffer(const AllocatedBuffer& buffer) const {
 }
 
 AllocatedImage SrsVkRenderer::CreateImage(VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped) {
+    uint32_t mipLevels = 1;
+    if (mipmapped) {
+        mipLevels = static_cast<uint32_t>(std::floor(std::log2((std::max)(size.width, size.height)))) + 1;
+    }
+    return CreateImage(size, format, usage, mipLevels);
+}
+
+AllocatedImage SrsVkRenderer::CreateImage(VkExtent3D size, VkFormat format, VkImageUsageFlags usage, uint32_t mipLevels) {
     AllocatedImage newImage{};
     newImage.imageFormat = format;
     newImage.imageExtent = size;
 
     VkImageCreateInfo imageInfo = init::image_create_info(format, usage, size);
-    if (mipmapped) {
-        imageInfo.mipLevels = static_cast<uint32_t>(std::floor(std::log2((std::max)(size.width, size.height)))) + 1;
-    }
+    imageInfo.mipLevels = mipLevels;
 
     VmaAllocationCreateInfo allocInfo{};
     allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
@@ -418,47 +1077,26 @@ AllocatedImage SrsVkRenderer::CreateImage(VkExtent3D size, VkFormat format, VkIm
     return newImage;
 }
 
-AllocatedImage SrsVkRenderer::CreateImage(void* data, VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped) {
-    size_t dataSize = size.depth * size.width * size.height * 4;
-    AllocatedBuffer uploadBuffer = CreateBuffer(dataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+AllocatedImage SrsVkRenderer::CreateImage(const void* data, VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped) {
+    UploadBatch batch(uploadService_);
+    return CreateImage(batch, data, size, format, usage, mipmapped);
+}
 
-    memcpy(uploadBuffer.info.pMappedData, data, dataSize);
+AllocatedImage SrsVkRenderer::CreateImage(UploadBatch& batch, const void* data, VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped) {
+    const size_t dataSize = size.depth * size.width * size.height * 4;
 
     const AllocatedImage newImage = CreateImage(size, format, usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, mipmapped);
 
-    ImmediateSubmit([&](VkCommandBuffer cmd) {
-        constexpr Utils::TransitionFlags beforeTransferFlags{
-            .srcStageMask = VK_PIPELINE_STAGE_2_NONE,
-            .srcAccessMask = 0,
-            .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-            .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
-        };
-        Utils::TransitionImage(cmd, newImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, beforeTransferFlags);
-
-        VkBufferImageCopy copyRegion = {};
-        copyRegion.bufferOffset = 0;
-        copyRegion.bufferRowLength = 0;
-        copyRegion.bufferImageHeight = 0;
-
-        copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        copyRegion.imageSubresource.mipLevel = 0;
-        copyRegion.imageSubresource.baseArrayLayer = 0;
-        copyRegion.imageSubresource.layerCount = 1;
-        copyRegion.imageExtent = size;
-
-        // copy the buffer into the image
-        vkCmdCopyBufferToImage(cmd, uploadBuffer.buffer, newImage.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
-
-        Utils::TransitionFlags afterTransferFlags{
-            .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-            .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
-            .dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, // TODO What if the image is used somewhere else?
-            .dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT,
-        };
-        Utils::TransitionImage(cmd, newImage.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, afterTransferFlags);
-    });
+    batch.AddImage(newImage, std::span(static_cast<const std::byte*>(data), dataSize), mipmapped);
 
-    DestroyBuffer(uploadBuffer);
+    return newImage;
+}
+
+AllocatedImage SrsVkRenderer::CreateImage(UploadBatch& batch, const TranscodedTexture& texture, VkImageUsageFlags usage) {
+    const auto mipLevels = static_cast<uint32_t>(texture.levelOffsets.size());
+    const AllocatedImage newImage = CreateImage(texture.extent, texture.format, usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT, mipLevels);
+
+    batch.AddImageLevels(newImage, texture.data, texture.levelOffsets);
 
     return newImage;
 }
@@ -468,54 +1106,82 @@ void SrsVkRenderer::DestroyImage(const AllocatedImage& image) const {
     vmaDestroyImage(allocator_, image.image, image.allocation);
 }
 
-GpuMeshBuffers SrsVkRenderer::UploadMesh(std::span<uint32_t> indices, std::span<Vertex> vertices) {
-    const size_t vertexBufferSize = vertices.size() * sizeof(Vertex);
-    const size_t indexBufferSize = indices.size() * sizeof(uint32_t);
-
-    GpuMeshBuffers newBuffer{};
-
-    newBuffer.vertexBuffer = CreateBuffer(vertexBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
-    VkBufferDeviceAddressInfo deviceAddressInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO};
-
-    deviceAddressInfo.buffer = newBuffer.vertexBuffer.buffer;
-    newBuffer.vertexBufferAddress = vkGetBufferDeviceAddress(device_, &deviceAddressInfo);
+GpuMeshBuffers SrsVkRenderer::UploadMesh(std::span<const uint32_t> indices, std::span<const Vertex> vertices, std::span<const Meshlet> meshlets) {
+    UploadBatch batch(uploadService_);
+    GpuMeshBuffers newBuffer = UploadMesh(batch, indices, vertices, meshlets);
+    batch.Submit();
+    return newBuffer;
+}
 
-    newBuffer.indexBuffer = CreateBuffer(indexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+GpuMeshBuffers SrsVkRenderer::UploadMesh(UploadBatch& batch, std::span<const uint32_t> indices, std::span<const Vertex> vertices, std::span<const Meshlet> meshlets) {
+    // The batch stages the data right away, the packed copies only have to live until the upload is recorded
+    const PackedVertices packedVertices = PackVertices(vertices, compactVerticesEnabled_);
+    const PackedIndices packedIndices = PackIndices(indices, vertices.size());
+    return UploadMesh(batch, packedIndices.GetData(), packedVertices.GetData(), meshlets);
+}
 
-    // Staging buffer to load data on and copy it to the GPU_ONLY buffer
-    AllocatedBuffer staging = CreateBuffer(vertexBufferSize + indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+GpuMeshBuffers SrsVkRenderer::UploadMesh(UploadBatch& batch, const IndexData& indices, const VertexData& vertices, std::span<const Meshlet> meshlets) {
+    GpuMeshBuffers newBuffer{};
+    newBuffer.vertexFormat = vertices.format;
+    newBuffer.quantization = vertices.quantization;
 
-    void* data = staging.allocation->GetMappedData();
+    newBuffer.vertexRange = meshArena_.AllocateVertices(vertices.GetCount(), newBuffer.vertexFormat);
+    newBuffer.vertexBufferAddress = meshArena_.GetVertexBufferAddress(newBuffer.vertexFormat, newBuffer.vertexRange.page);
+    newBuffer.vertexOffset = static_cast<int32_t>(newBuffer.vertexRange.offset);
 
-    // copy vertex buffer
-    memcpy(data, vertices.data(), vertexBufferSize);
-    // copy index buffer
-    memcpy(static_cast<char*>(data) + vertexBufferSize, indices.data(), indexBufferSize);
+    newBuffer.indexType = indices.type;
+    newBuffer.indexRange = meshArena_.AllocateIndices(indices.GetCount(), newBuffer.indexType);
+    newBuffer.indexBuffer = meshArena_.GetIndexBuffer(newBuffer.indexType, newBuffer.indexRange.page);
+    newBuffer.indexBufferAddress = meshArena_.GetIndexBufferAddress(newBuffer.indexType, newBuffer.indexRange.page);
+    newBuffer.firstIndex = newBuffer.indexRange.offset;
 
-    ImmediateSubmit([&](VkCommandBuffer cmd) {
-        VkBufferCopy vertexCopy{};
-        vertexCopy.dstOffset = 0;
-        vertexCopy.srcOffset = 0;
-        vertexCopy.size = vertexBufferSize;
+    // Points at the mesh's first meshlet, a mesh without meshlets is only culled as a whole
+    newBuffer.meshletRange = meshArena_.AllocateMeshlets(static_cast<uint32_t>(meshlets.size()));
+    newBuffer.meshletBufferAddress = meshArena_.GetMeshletBufferAddress(newBuffer.meshletRange.page) + newBuffer.meshletRange.offset * sizeof(Meshlet);
 
-        vkCmdCopyBuffer(cmd, staging.buffer, newBuffer.vertexBuffer.buffer, 1, &vertexCopy);
+    // Arena pages are shared by the graphics and transfer families, no ownership transfer needed
+    batch.AddBuffer(meshArena_.GetVertexBuffer(newBuffer.vertexFormat, newBuffer.vertexRange.page), newBuffer.vertexRange.offset * GetVertexStride(newBuffer.vertexFormat),
+                    vertices.bytes, true);
+    batch.AddBuffer(newBuffer.indexBuffer, newBuffer.indexRange.offset * GetIndexSize(newBuffer.indexType), indices.bytes, true);
+    batch.AddBuffer(meshArena_.GetMeshletBuffer(newBuffer.meshletRange.page), newBuffer.meshletRange.offset * sizeof(Meshlet), std::as_bytes(meshlets), true);
 
-        VkBufferCopy indexCopy{0};
-        indexCopy.dstOffset = 0;
-        indexCopy.srcOffset = vertexBufferSize;
-        indexCopy.size = indexBufferSize;
+    return newBuffer;
+}
 
-        vkCmdCopyBuffer(cmd, staging.buffer, newBuffer.indexBuffer.buffer, 1, &indexCopy);
+void SrsVkRenderer::FreeMesh(const GpuMeshBuffers& mesh) {
+    // Every frame recorded so far may still draw the mesh
+    DeferDeletion([this, mesh]() {
+        meshArena_.FreeVertices(mesh.vertexRange, mesh.vertexFormat);
+        meshArena_.FreeIndices(mesh.indexRange, mesh.indexType);
+        meshArena_.FreeMeshlets(mesh.meshletRange);
     });
+}
 
-    DestroyBuffer(staging);
+void SrsVkRenderer::ReleaseMaterial(const MaterialInstance& material) {
+    materialIds_.Release(material.materialSet);
+}
 
-    return newBuffer;
+void SrsVkRenderer::DeferDeletion(std::function<void()>&& function) {
+    deferredDeletions_.push_back({frameNumber_, std::move(function)});
+}
+
+void SrsVkRenderer::FlushDeferredDeletions(int completedFrame) {
+    // Pushed in frame order, the oldest ones come first
+    while (!deferredDeletions_.empty() && deferredDeletions_.front().frameNumber <= completedFrame) {
+        deferredDeletions_.front().function();
+        deferredDeletions_.pop_front();
+    }
 }
 
 void SrsVkRenderer::SpawnImguiWindow() {
+    if (headless_) {
+        return;
+    }
+
     ImGui_ImplVulkan_NewFrame();
+#ifdef _WIN32
     ImGui_ImplWin32_NewFrame();
+#endif
 
     ImGui::NewFrame();
 
@@ -524,6 +1190,44 @@ void SrsVkRenderer::SpawnImguiWindow() {
         float framerate = ImGui::GetIO().Framerate;
         ImGui::Text("Framerate: %f", framerate);
 
+        const FrameStats& lastStats = frames_[(frameNumber_ + kFrameOverlap - 1) % kFrameOverlap].stats;
+        ImGui::Text("Draws: %u (%u instances), pipeline binds: %u, descriptor set binds: %u, index buffer binds: %u", lastStats.drawCount, lastStats.instanceCount,
+                    lastStats.pipelineBinds, lastStats.descriptorSetBinds, lastStats.indexBufferBinds);
+
+        ImGui::Checkbox("Frustum culling", &frustumCullingEnabled_);
+        if (drawIndirectCountSupported_) {
+            ImGui::Checkbox("GPU driven drawing", &gpuDrivenEnabled_);
+            if (meshletCullPipeline_ != VK_NULL_HANDLE) {
+                ImGui::Checkbox("Meshlet culling", &meshletCullingEnabled_);
+            }
+        }
+        ImGui::Checkbox("Parallel recording", &parallelRecordingEnabled_);
+        ImGui::Checkbox("Instancing", &instancingEnabled_);
+        ImGui::Checkbox("Mesh LOD", &lodEnabled_);
+        if (lodEnabled_) {
+            ImGui::SliderFloat("LOD error (pixels)", &lodErrorPixels_, 0.25f, 8.0f);
+        }
+        ImGui::Text("Visible surfaces: %u, culled surfaces: %u, simplified surfaces: %u", lastStats.visibleSurfaces, lastStats.culledSurfaces,
+                    lastStats.simplifiedSurfaces);
+
+        const PipelineCacheStats& pipelineStats = pipelineCache_.GetStats();
+        ImGui::Text("Pipeline cache: %u hits, %u misses, %.1f ms creating pipelines", pipelineStats.hits, pipelineStats.misses + pipelineStats.unknown,
+                    pipelineStats.creationMs);
+
+        if (ImGui::CollapsingHeader("GPU passes", ImGuiTreeNodeFlags_DefaultOpen)) {
+            for (const auto& [name, milliseconds, offset] : gpuProfiler_.GetHistory()) {
+                const float latest = milliseconds[(offset + GpuProfiler::kHistoryLength - 1) % GpuProfiler::kHistoryLength];
+                const std::string overlay = fmt::format("{:.3f} ms", latest);
+                ImGui::PlotLines(name, milliseconds.data(), static_cast<int>(GpuProfiler::kHistoryLength), static_cast<int>(offset), overlay.c_str(), 0.0f, FLT_MAX, ImVec2(0, 40));
+            }
+        }
+
+#ifdef SIRIUS_PROFILING
+        if (ImGui::Button("Write CPU trace")) {
+            Profiler::WriteChromeTrace("trace.json");
+        }
+#endif
+
         ComputeEffect& selected = computeEffects_[currentEffect_];
 
         ImGui::Text("Selected effect: ", selected.name);
@@ -544,8 +1248,20 @@ void SrsVkRenderer::Shutdown() {
     if (isInitialized_) {
         vkDeviceWaitIdle(device_);
 
+        // Every pipeline exists by now, the next run finds all of them in the cache
+        pipelineCache_.Save();
+
         loadedScenes_.clear();
 
+        // Hand out the frames that are still in flight, the device is idle so all of them are complete
+        for (int i = 0; i < static_cast<int>(kFrameOverlap); i++) {
+            const uint32_t frameIndex = (frameNumber_ + i) % kFrameOverlap;
+            DeliverFrameStats(frameIndex);
+            if (headless_) {
+                DeliverReadback(frames_[frameIndex]);
+            }
+        }
+
         for (auto& frame : frames_) {
             vkDestroyCommandPool(device_, frame.commandPool, nullptr);
 
@@ -554,16 +1270,13 @@ void SrsVkRenderer::Shutdown() {
 
             frame.deletionQueue.Flush();
         }
-        for (const auto& mesh : testMeshes_) {
-            DestroyBuffer(mesh->meshBuffers.indexBuffer);
-            DestroyBuffer(mesh->meshBuffers.vertexBuffer);
-        }
-
         for (const auto semaphore : submitSemaphores_) {
             vkDestroySemaphore(device_, semaphore, nullptr);
         }
+        FlushDeferredDeletions(std::numeric_limits<int>::max());
 
         mainDeletionQueue_.Flush();
+        JobSystem::Shutdown();
     }
 }
 
@@ -593,8 +1306,14 @@ bool SrsVkRenderer::CheckValidationLayerSupport() {
 }
 
 void SrsVkRenderer::CreateInstance() {
-    if (kEnableValidationLayers && !CheckValidationLayerSupport()) {
-        throw std::runtime_error("validation layers requested, but not available!");
+    validationEnabled_ = kEnableValidationLayers;
+    if (validationEnabled_ && !CheckValidationLayerSupport()) {
+        // CI machines running headless usually only have the driver installed
+        if (!headless_) {
+            throw std::runtime_error("validation layers requested, but not available!");
+        }
+        std::cout << "Vulkan: Validation layers not available, continuing without them\n" << std::endl;
+        validationEnabled_ = false;
     }
     VkApplicationInfo appInfo{};
     appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -609,14 +1328,18 @@ void SrsVkRenderer::CreateInstance() {
     createInfo.pApplicationInfo = &appInfo;
 
     std::vector requiredExtensions = {
-        VK_KHR_SURFACE_EXTENSION_NAME,
-        VK_KHR_WIN32_SURFACE_EXTENSION_NAME,
         VK_EXT_DEBUG_UTILS_EXTENSION_NAME
     };
+    if (!headless_) {
+        requiredExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+#ifdef _WIN32
+        requiredExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+#endif
+    }
     createInfo.enabledExtensionCount = requiredExtensions.size();
     createInfo.ppEnabledExtensionNames = requiredExtensions.data();
 
-    if (kEnableValidationLayers) {
+    if (validationEnabled_) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers_.size());
         createInfo.ppEnabledLayerNames = validationLayers_.data();
     } else {
@@ -630,6 +1353,7 @@ void SrsVkRenderer::CreateInstance() {
 }
 
 void SrsVkRenderer::CreateSurface() {
+#ifdef _WIN32
     VkWin32SurfaceCreateInfoKHR createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
     createInfo.hwnd = hwndMain;
@@ -638,6 +1362,7 @@ void SrsVkRenderer::CreateSurface() {
         throw std::runtime_error("Failed to create window surface!");
     }
     std::cout << "Vulkan: Surface created\n" << std::endl;
+#endif
 }
 
 void SrsVkRenderer::PickPhysicalDevice() {
@@ -667,7 +1392,10 @@ void SrsVkRenderer::CreateLogicalDevice() {
     QueueFamilyIndices indices = FindQueueFamilies(physicalDevice_);
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    graphicsFamily_ = indices.graphicsFamily.value();
+    transferFamily_ = indices.transferFamily.value_or(graphicsFamily_);
+
+    std::set uniqueQueueFamilies = {graphicsFamily_, indices.presentFamily.value(), transferFamily_};
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -705,6 +1433,17 @@ void SrsVkRenderer::CreateLogicalDevice() {
     features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
     features12.bufferDeviceAddress = VK_TRUE;
     features12.descriptorIndexing = VK_TRUE;
+    features12.timelineSemaphore = VK_TRUE;
+    // Optional, without it geometry is drawn with one call per object
+    features12.drawIndirectCount = supported12.drawIndirectCount;
+    drawIndirectCountSupported_ = supported12.drawIndirectCount == VK_TRUE;
+
+    // Optional, compressed textures fall back to RGBA8 without them
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.features.textureCompressionBC = supportedFeatures.features.textureCompressionBC;
+    features.features.textureCompressionASTC_LDR = supportedFeatures.features.textureCompressionASTC_LDR;
+    enabledFeatures_ = features.features;
 
     VkPhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeatures{};
     shaderObjectFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT;
@@ -712,7 +1451,8 @@ void SrsVkRenderer::CreateLogicalDevice() {
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    createInfo.pNext = &shaderObjectFeatures;
+    createInfo.pNext = &features;
+    features.pNext = &shaderObjectFeatures;
     shaderObjectFeatures.pNext = &features13;
     features13.pNext = &features12;
 
@@ -723,7 +1463,7 @@ void SrsVkRenderer::CreateLogicalDevice() {
     createInfo.ppEnabledExtensionNames = deviceExtensions_.data();
 
 
-    if (kEnableValidationLayers) {
+    if (validationEnabled_) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers_.size());
         createInfo.ppEnabledLayerNames = validationLayers_.data();
     } else {
@@ -737,14 +1477,15 @@ void SrsVkRenderer::CreateLogicalDevice() {
 
     vkGetDeviceQueue(device_, indices.graphicsFamily.value(), 0, &graphicsQueue_);
     vkGetDeviceQueue(device_, indices.presentFamily.value(), 0, &presentQueue_);
+    vkGetDeviceQueue(device_, transferFamily_, 0, &transferQueue_);
 }
 
 bool SrsVkRenderer::IsDeviceSuitable(VkPhysicalDevice device) {
     QueueFamilyIndices indices = FindQueueFamilies(device);
 
     bool extensionsSupported = CheckDeviceExtensionSupport(device);
-    bool swapChainAdequate = false;
-    if (extensionsSupported) {
+    bool swapChainAdequate = headless_;
+    if (extensionsSupported && !headless_) {
         SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device);
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
@@ -765,8 +1506,13 @@ SrsVkRenderer::QueueFamilyIndices SrsVkRenderer::FindQueueFamilies(VkPhysicalDev
             indices.graphicsFamily = i;
         }
 
+        // Without a surface nothing is presented, the graphics queue stands in for the present queue
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+        if (surface_ != VK_NULL_HANDLE) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+        } else {
+            presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        }
 
         if (presentSupport) {
             indices.presentFamily = i;
@@ -777,6 +1523,17 @@ SrsVkRenderer::QueueFamilyIndices SrsVkRenderer::FindQueueFamilies(VkPhysicalDev
         }
         i++;
     }
+
+    for (uint32_t family = 0; family < queueFamilyCount; family++) {
+        const VkQueueFlags flags = queueFamilies[family].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+            indices.transferFamily = family;
+            // Prefer a pure copy family over async compute
+            if (!(flags & VK_QUEUE_COMPUTE_BIT)) {
+                break;
+            }
+        }
+    }
     return indices;
 }
 
@@ -876,6 +1633,10 @@ void SrsVkRenderer::CreateSwapChain(uint32_t width, uint32_t height) {
     swapChainImageFormat_ = surfaceFormat.format;
     swapChainExtent_ = extent;
 
+    CreateDrawImages(width, height);
+}
+
+void SrsVkRenderer::CreateDrawImages(uint32_t width, uint32_t height) {
     VkExtent3D drawImageExtent = {
         width,
         height,
@@ -954,8 +1715,10 @@ void SrsVkRenderer::ResizeSwapChain() {
     vkDeviceWaitIdle(device_);
     DestroySwapChain();
 
+#ifdef _WIN32
     CreateSwapChain(windowWidth, windowHeight);
     CreateImageViews();
+#endif
     resizeRequested_ = false;
 }
 
@@ -1060,21 +1823,16 @@ void SrsVkRenderer::InitCommandBuffers() {
         VK_CHECK(vkAllocateCommandBuffers(device_, &cmdAllocInfo, &frame.mainCommandBuffer));
     }
 
-    VK_CHECK(vkCreateCommandPool(device_, &commandPoolInfo, nullptr, &immCommandPool_));
-
-    // allocate the command buffer for immediate submits
-
-    VkCommandBufferAllocateInfo cmdAllocInfo = {};
-    cmdAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    cmdAllocInfo.pNext = nullptr;
-    cmdAllocInfo.commandPool = immCommandPool_;
-    cmdAllocInfo.commandBufferCount = 1;
-    cmdAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-
-    VK_CHECK(vkAllocateCommandBuffers(device_, &cmdAllocInfo, &immCommandBuffer_));
+    parallelRecorder_.Init(device_, graphicsFamily_, kFrameOverlap);
+    mainDeletionQueue_.PushFunction([this]() {
+        parallelRecorder_.Destroy();
+    });
+}
 
+void SrsVkRenderer::InitUploadService() {
+    uploadService_.Init(device_, allocator_, transferQueue_, transferFamily_, graphicsFamily_);
     mainDeletionQueue_.PushFunction([this]() {
-        vkDestroyCommandPool(device_, immCommandPool_, nullptr);
+        uploadService_.Destroy();
     });
 }
 
@@ -1096,9 +1854,6 @@ void SrsVkRenderer::InitSyncObjects() {
     for (int i = 0; i < swapChainImages_.size(); i++) {
         VK_CHECK(vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &submitSemaphores_[i]));
     }
-
-    VK_CHECK(vkCreateFence(device_, &fenceInfo, nullptr, &immFence_));
-    mainDeletionQueue_.PushFunction([this]() { vkDestroyFence(device_, immFence_, nullptr); });
 }
 
 void SrsVkRenderer::InitAllocator() {
@@ -1112,6 +1867,15 @@ void SrsVkRenderer::InitAllocator() {
     mainDeletionQueue_.PushFunction([&]() {
         vmaDestroyAllocator(allocator_);
     });
+
+    std::vector<uint32_t> meshQueueFamilies = {graphicsFamily_};
+    if (transferFamily_ != graphicsFamily_) {
+        meshQueueFamilies.push_back(transferFamily_);
+    }
+    meshArena_.Init(device_, allocator_, std::move(meshQueueFamilies));
+    mainDeletionQueue_.PushFunction([this]() {
+        meshArena_.Destroy();
+    });
 }
 
 void SrsVkRenderer::InitDescriptors() {
@@ -1153,6 +1917,9 @@ void SrsVkRenderer::InitDescriptors() {
         vkDestroyDescriptorSetLayout(device_, singleImageDescriptorLayout_, nullptr);
     });
 
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice_, &properties);
+
     for (auto& frame : frames_) {
         std::vector<DescriptorAllocatorGrowable::PoolSizeRatio> frameSizes = {
             {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3},
@@ -1164,8 +1931,11 @@ void SrsVkRenderer::InitDescriptors() {
         frame.frameDescriptors = DescriptorAllocatorGrowable{};
         frame.frameDescriptors.Init(device_, 1000, frameSizes);
 
+        frame.uniformAllocator.Init(allocator_, kFrameUniformCapacity, properties.limits.minUniformBufferOffsetAlignment);
+
         mainDeletionQueue_.PushFunction([&] {
             frame.frameDescriptors.DestroyPools(device_);
+            frame.uniformAllocator.Destroy();
         });
     }
 }
@@ -1173,7 +1943,16 @@ void SrsVkRenderer::InitDescriptors() {
 void SrsVkRenderer::InitPipelines() {
     InitBackgroundPipelines();
     InitMeshPipeline();
-    metalRoughMaterial_.BuildPipelines(device_, drawImage_.imageFormat, depthImage_.imageFormat, sceneDataDescriptorLayout_);
+    InitCullPipeline();
+    metalRoughMaterial_.BuildPipelines(device_, pipelineCache_, drawImage_.imageFormat, depthImage_.imageFormat, sceneDataDescriptorLayout_);
+
+    const PipelineCacheStats& stats = pipelineCache_.GetStats();
+    fmt::println("Pipeline cache: {:.1f} KB loaded, {} hits {} misses, {:.1f} ms creating pipelines", static_cast<double>(stats.loadedBytes) / 1024.0, stats.hits,
+                 stats.misses + stats.unknown, stats.creationMs);
+
+    mainDeletionQueue_.PushFunction([this]() {
+        pipelineCache_.Destroy();
+    });
 }
 
 void SrsVkRenderer::InitBackgroundPipelines() {
@@ -1225,7 +2004,7 @@ void SrsVkRenderer::InitBackgroundPipelines() {
         glm::vec4(0, 0, 1, 1)
     };
 
-    VK_CHECK(vkCreateComputePipelines(device_,VK_NULL_HANDLE,1,&computePipelineCreateInfo, nullptr, &gradient.pipeline));
+    VK_CHECK(pipelineCache_.CreateComputePipeline(computePipelineCreateInfo, &gradient.pipeline));
 
     computePipelineCreateInfo.stage.module = skyShader;
 
@@ -1236,7 +2015,7 @@ void SrsVkRenderer::InitBackgroundPipelines() {
         glm::vec4(0.1f, 0.2f, 0.4f, 0.97f)
     };
 
-    VK_CHECK(vkCreateComputePipelines(device_,VK_NULL_HANDLE,1,&computePipelineCreateInfo, nullptr, &sky.pipeline));
+    VK_CHECK(pipelineCache_.CreateComputePipeline(computePipelineCreateInfo, &sky.pipeline));
 
     computeEffects_.push_back(gradient);
     computeEffects_.push_back(sky);
@@ -1251,6 +2030,71 @@ void SrsVkRenderer::InitBackgroundPipelines() {
     });
 }
 
+void SrsVkRenderer::InitCullPipeline() {
+    VkPushConstantRange pushConstant{};
+    pushConstant.offset = 0;
+    pushConstant.size = sizeof(GpuCullPushConstants);
+    pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkPipelineLayoutCreateInfo layoutInfo = init::pipeline_layout_create_info();
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushConstant;
+
+    VK_CHECK(vkCreatePipelineLayout(device_, &layoutInfo, nullptr, &cullPipelineLayout_));
+
+    VkShaderModule cullShader;
+    if (!LoadShaderModule("../../src/sirius/shaders/cull.comp.spv", device_, &cullShader)) {
+        fmt::print("Error when building the cull compute shader \n");
+    }
+
+    VkComputePipelineCreateInfo computePipelineCreateInfo{.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+    computePipelineCreateInfo.layout = cullPipelineLayout_;
+    computePipelineCreateInfo.stage = init::pipeline_shader_stage_create_info(VK_SHADER_STAGE_COMPUTE_BIT, cullShader);
+
+    VK_CHECK(pipelineCache_.CreateComputePipeline(computePipelineCreateInfo, &cullPipeline_));
+
+    vkDestroyShaderModule(device_, cullShader, nullptr);
+
+    VkPushConstantRange meshletPushConstant{};
+    meshletPushConstant.offset = 0;
+    meshletPushConstant.size = sizeof(GpuMeshletCullPushConstants);
+    meshletPushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    layoutInfo.pPushConstantRanges = &meshletPushConstant;
+
+    VK_CHECK(vkCreatePipelineLayout(device_, &layoutInfo, nullptr, &meshletCullPipelineLayout_));
+
+    // Meshlet culling is optional, without its shader the surfaces are drawn whole
+    VkShaderModule meshletCullShader;
+    if (LoadShaderModule("../../src/sirius/shaders/cull_meshlets.comp.spv", device_, &meshletCullShader)) {
+        computePipelineCreateInfo.layout = meshletCullPipelineLayout_;
+        computePipelineCreateInfo.stage = init::pipeline_shader_stage_create_info(VK_SHADER_STAGE_COMPUTE_BIT, meshletCullShader);
+
+        VK_CHECK(pipelineCache_.CreateComputePipeline(computePipelineCreateInfo, &meshletCullPipeline_));
+
+        vkDestroyShaderModule(device_, meshletCullShader, nullptr);
+    } else {
+        fmt::print("Error when building the meshlet cull compute shader, meshlet culling is disabled \n");
+        meshletCullPipeline_ = VK_NULL_HANDLE;
+        meshletCullingEnabled_ = false;
+    }
+
+    mainDeletionQueue_.PushFunction([this]() {
+        for (auto& frame : frames_) {
+            if (frame.indirectCapacity > 0) {
+                DestroyIndirectBuffers(frame);
+            }
+            if (frame.compactedIndexCapacity > 0) {
+                DestroyBuffer(frame.compactedIndexBuffer);
+                frame.compactedIndexCapacity = 0;
+            }
+        }
+        vkDestroyPipeline(device_, cullPipeline_, nullptr);
+        vkDestroyPipelineLayout(device_, cullPipelineLayout_, nullptr);
+        vkDestroyPipeline(device_, meshletCullPipeline_, nullptr);
+        vkDestroyPipelineLayout(device_, meshletCullPipelineLayout_, nullptr);
+    });
+}
+
 void SrsVkRenderer::InitMeshPipeline() {
     VkShaderModule fragShader;
     if (!LoadShaderModule("../../src/sirius/shaders/textured_image.frag.spv", device_, &fragShader)) {
@@ -1266,9 +2110,10 @@ void SrsVkRenderer::InitMeshPipeline() {
         fmt::print("Triangle vertex shader successfully loaded\n");
     }
 
+    // Render matrix and vertex buffer of colored_triangle_mesh.vert
     VkPushConstantRange bufferRange{};
     bufferRange.offset = 0;
-    bufferRange.size = sizeof(GpuDrawPushConstants);
+    bufferRange.size = sizeof(glm::mat4) + sizeof(VkDeviceAddress);
     bufferRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
     VkPipelineLayoutCreateInfo pipelineLayoutInfo = init::pipeline_layout_create_info();
@@ -1303,7 +2148,7 @@ void SrsVkRenderer::InitMeshPipeline() {
     pipelineBuilder.SetDepthFormat(depthImage_.imageFormat);
 
     //finally build the pipeline
-    meshPipeline_ = pipelineBuilder.BuildPipeline(device_);
+    meshPipeline_ = pipelineBuilder.BuildPipeline(pipelineCache_);
 
     //clean structures
     vkDestroyShaderModule(device_, fragShader, nullptr);
@@ -1338,23 +2183,20 @@ void SrsVkRenderer::InitDefaultData() {
     rectIndices[4] = 1;
     rectIndices[5] = 3;
 
-    rectangle_ = UploadMesh(rectIndices, rectVertices);
+    UploadBatch batch(uploadService_);
 
-    //delete the rectangle data on engine shutdown
-    mainDeletionQueue_.PushFunction([&]() {
-        DestroyBuffer(rectangle_.indexBuffer);
-        DestroyBuffer(rectangle_.vertexBuffer);
-    });
+    // Lives in the mesh arena until it is destroyed on shutdown
+    rectangle_ = UploadMesh(batch, rectIndices, rectVertices);
 
     //3 default textures, white, grey, black. 1 pixel each
     uint32_t white = glm::packUnorm4x8(glm::vec4(1, 1, 1, 1));
-    whiteImage_ = CreateImage((void*) &white, VkExtent3D{1, 1, 1}, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
+    whiteImage_ = CreateImage(batch, (void*) &white, VkExtent3D{1, 1, 1}, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
 
     uint32_t grey = glm::packUnorm4x8(glm::vec4(0.66f, 0.66f, 0.66f, 1));
-    greyImage_ = CreateImage((void*) &grey, VkExtent3D{1, 1, 1}, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
+    greyImage_ = CreateImage(batch, (void*) &grey, VkExtent3D{1, 1, 1}, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
 
     uint32_t black = glm::packUnorm4x8(glm::vec4(0, 0, 0, 0));
-    blackImage_ = CreateImage((void*) &black, VkExtent3D{1, 1, 1}, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
+    blackImage_ = CreateImage(batch, (void*) &black, VkExtent3D{1, 1, 1}, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
 
     // checkerboard image
     const uint32_t magenta = glm::packUnorm4x8(glm::vec4(1, 0, 1, 1));
@@ -1364,7 +2206,8 @@ void SrsVkRenderer::InitDefaultData() {
             pixels[y * 16 + x] = ((x % 2) ^ (y % 2)) ? magenta : black;
         }
     }
-    errorCheckerboardImage_ = CreateImage(pixels.data(), VkExtent3D{16, 16, 1}, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
+    errorCheckerboardImage_ = CreateImage(batch, pixels.data(), VkExtent3D{16, 16, 1}, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
+    batch.Submit();
 
     VkSamplerCreateInfo samplerCreateInfo = {.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
     samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
@@ -1413,8 +2256,8 @@ void SrsVkRenderer::InitDefaultData() {
     for (auto& mesh : testMeshes_) {
         std::shared_ptr newNode{std::make_shared<MeshNode>()};
         newNode->mesh_ = mesh;
-        newNode->localTransform_ = glm::mat4{1.0f};
-        newNode->worldTransform_ = glm::mat4{1.0f};
+        newNode->transforms_ = &testNodeTransforms_;
+        newNode->transformIndex_ = testNodeTransforms_.Add(TransformHierarchy::kNoParent, glm::mat4{1.0f});
 
         for (auto& surface : newNode->mesh_->surfaces) {
             surface.material = std::make_shared<GltfMaterial>(defaultMaterialData_);
@@ -1422,11 +2265,13 @@ void SrsVkRenderer::InitDefaultData() {
 
         loadedNodes_[mesh->name] = std::move(newNode);
     }
+    testNodeTransforms_.Update();
 
-    std::string structurePath = { "../../resources/structure.glb" };
-    auto structureFile = LoadGltf(this, structurePath);
-    assert(structureFile.has_value());
-    loadedScenes_["structure"] = *structureFile;
+    // Cooked packages skip parsing and decoding, see sirius-cook
+    const bool cooked = std::filesystem::path(scenePath_).extension() == kScenePackageExtension;
+    auto sceneFile = cooked ? LoadScenePackage(this, scenePath_) : LoadGltf(this, scenePath_);
+    assert(sceneFile.has_value());
+    loadedScenes_[std::filesystem::path(scenePath_).stem().string()] = *sceneFile;
 }
 
 void SrsVkRenderer::InitImgui() {
@@ -1458,7 +2303,9 @@ void SrsVkRenderer::InitImgui() {
 
     ImGui::CreateContext();
 
+#ifdef _WIN32
     ImGui_ImplWin32_Init(hwndMain);
+#endif
 
     ImGui_ImplVulkan_InitInfo info = {};
     info.Instance = instance_;
@@ -1469,6 +2316,7 @@ void SrsVkRenderer::InitImgui() {
     info.MinImageCount = 3;
     info.ImageCount = 3;
     info.UseDynamicRendering = true;
+    info.PipelineCache = pipelineCache_.GetHandle();
 
     info.PipelineInfoMain.PipelineRenderingCreateInfo = {.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
     info.PipelineInfoMain.PipelineRenderingCreateInfo.colorAttachmentCount = 1;
@@ -1495,29 +2343,102 @@ void SrsVkRenderer::DrawImgui(VkCommandBuffer cmd, VkImageView targetImageView)
     vkCmdEndRendering(cmd);
 }
 
+void SrsVkRenderer::SetReadbackCallback(std::function<void(const FrameReadback&)>&& callback) {
+    readbackCallback_ = std::move(callback);
+}
 
-// Record commands to a Command Buffer, submit them immediately to the GPU and wait for it to be finished with them
-void SrsVkRenderer::ImmediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function) {
-    VK_CHECK(vkResetFences(device_, 1, &immFence_));
-    VK_CHECK(vkResetCommandBuffer(immCommandBuffer_, 0));
+void SrsVkRenderer::SetFrameStatsCallback(std::function<void(const FrameStats&)>&& callback) {
+    frameStatsCallback_ = std::move(callback);
+}
 
-    VkCommandBuffer cmd = immCommandBuffer_;
+void SrsVkRenderer::InitGpuProfiler() {
+    gpuProfiler_.Init(device_, physicalDevice_, FindQueueFamilies(physicalDevice_).graphicsFamily.value(), kFrameOverlap);
 
-    VkCommandBufferBeginInfo cmdBeginInfo = init::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    mainDeletionQueue_.PushFunction([this]() {
+        gpuProfiler_.Destroy();
+    });
+}
 
-    VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+void SrsVkRenderer::DeliverFrameStats(uint32_t frameIndex) {
+    FrameData& frame = frames_[frameIndex];
+    if (!frame.statsPending) {
+        return;
+    }
+    frame.statsPending = false;
+
+    // The frame fence has signaled, so the results are available without waiting
+    if (gpuProfiler_.Resolve(frameIndex)) {
+        const auto passes = gpuProfiler_.GetResults();
+        frame.stats.gpuPasses.assign(passes.begin(), passes.end());
+        // The whole frame is the first scope that gets opened
+        frame.stats.gpuFrameMs = passes.front().milliseconds;
+    }
+
+    if (frameStatsCallback_) {
+        frameStatsCallback_(frame.stats);
+    }
+}
 
-    function(cmd);
+void SrsVkRenderer::InitReadback() {
+    // 4 channels of 16 bit floats
+    const size_t readbackSize = static_cast<size_t>(drawImage_.imageExtent.width) * drawImage_.imageExtent.height * 8;
 
-    VK_CHECK(vkEndCommandBuffer(cmd));
+    for (auto& frame : frames_) {
+        frame.readbackBuffer = CreateBuffer(readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+    }
+
+    mainDeletionQueue_.PushFunction([this]() {
+        for (const auto& frame : frames_) {
+            DestroyBuffer(frame.readbackBuffer);
+        }
+    });
+}
 
-    VkCommandBufferSubmitInfo cmdInfo = init::command_buffer_submit_info(cmd);
-    VkSubmitInfo2 submit = init::submit_info(&cmdInfo, nullptr, nullptr);
+void SrsVkRenderer::RecordReadback(VkCommandBuffer cmd) {
+    if (!readbackCallback_) {
+        return;
+    }
 
-    // submit command buffer to the queue and execute it.
-    //  _renderFence will now block until the graphic commands finish execution
-    VK_CHECK(vkQueueSubmit2(graphicsQueue_, 1, &submit, immFence_));
+    Utils::TransitionFlags beforeReadbackFlags{
+        .srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+        .srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+        .dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
+    };
+    Utils::TransitionImage(cmd, drawImage_.image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, beforeReadbackFlags);
 
-    VK_CHECK(vkWaitForFences(device_, 1, &immFence_, true, 9999999999));
+    VkBufferImageCopy copyRegion{};
+    copyRegion.bufferOffset = 0;
+    copyRegion.bufferRowLength = 0;
+    copyRegion.bufferImageHeight = 0;
+    copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    copyRegion.imageSubresource.mipLevel = 0;
+    copyRegion.imageSubresource.baseArrayLayer = 0;
+    copyRegion.imageSubresource.layerCount = 1;
+    copyRegion.imageExtent = {drawExtent_.width, drawExtent_.height, 1};
+
+    vkCmdCopyImageToBuffer(cmd, drawImage_.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, GetCurrentFrame().readbackBuffer.buffer, 1, &copyRegion);
+
+    GetCurrentFrame().readbackFrameNumber = frameNumber_;
+}
+
+void SrsVkRenderer::DeliverReadback(FrameData& frame) {
+    if (frame.readbackFrameNumber < 0) {
+        return;
+    }
+
+    VK_CHECK(vmaInvalidateAllocation(allocator_, frame.readbackBuffer.allocation, 0, VK_WHOLE_SIZE));
+
+    FrameReadback readback{};
+    readback.frameNumber = frame.readbackFrameNumber;
+    readback.extent = drawExtent_;
+    readback.format = drawImage_.imageFormat;
+    readback.data = frame.readbackBuffer.info.pMappedData;
+    readback.size = static_cast<size_t>(drawExtent_.width) * drawExtent_.height * 8;
+
+    frame.readbackFrameNumber = -1;
+    if (readbackCallback_) {
+        readbackCallback_(readback);
+    }
 }
 }
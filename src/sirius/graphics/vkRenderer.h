@@ -14,9 +14,18 @@
 #include <vec4.hpp>
 #include <vulkan/vulkan_core.h>
 #include "descriptors.h"
+#include "draw_registry.h"
+#include "draw_sort.h"
+#include "frame_allocator.h"
 
 #include "asset_loader.h"
 #include "camera.h"
+#include "gpu_profiler.h"
+#include "mesh_arena.h"
+#include "parallel_recorder.h"
+#include "texture_transcoder.h"
+#include "upload_service.h"
+#include "vertex_compression.h"
 #include "materials.h"
 
 namespace sirius {
@@ -38,6 +47,28 @@ public:
     }
 };
 
+struct FrameStats {
+    int frameNumber;
+    // CPU time spent in Draw, without waiting on the frame fence
+    double cpuFrameMs;
+    // Time between the first and last command of the frame on the GPU
+    double gpuFrameMs;
+    uint32_t drawCount;
+    // Objects behind the draws, instancing draws several at once
+    uint32_t instanceCount;
+    uint64_t triangleCount;
+    // State changes left after sorting the draws
+    uint32_t pipelineBinds;
+    uint32_t descriptorSetBinds;
+    uint32_t indexBufferBinds;
+    uint32_t visibleSurfaces;
+    uint32_t culledSurfaces;
+    // Visible surfaces drawn at one of their LODs
+    uint32_t simplifiedSurfaces;
+    // Every profiled pass of the frame, including the whole frame itself
+    std::vector<GpuPassTiming> gpuPasses;
+};
+
 struct FrameData {
     VkFence renderFence;
     VkSemaphore acquireSemaphore;
@@ -46,8 +77,50 @@ struct FrameData {
     VkCommandBuffer mainCommandBuffer;
 
     DescriptorAllocatorGrowable frameDescriptors;
+    // Scene data and other per-frame constants, reset together with the descriptors
+    FrameUniformAllocator uniformAllocator;
 
     DeletionQueue deletionQueue;
+
+    // Headless only: host visible copy of the draw image, handed out once the render fence of this frame has signaled
+    AllocatedBuffer readbackBuffer;
+    int readbackFrameNumber{-1};
+
+    FrameStats stats;
+    bool statsPending{false};
+
+    // GPU driven drawing: object data written by the CPU, draw commands and per-bucket counts written by the cull shader
+    AllocatedBuffer objectBuffer;
+    AllocatedBuffer indirectBuffer;
+    AllocatedBuffer drawCountBuffer;
+    uint32_t indirectCapacity{0};
+    // Meshlet culling: visible triangles of every object, each object owns a range as large as its full index count
+    AllocatedBuffer compactedIndexBuffer;
+    uint32_t compactedIndexCapacity{0};
+};
+
+struct RendererConfig {
+    // Render into the draw image only, without a window, surface or swapchain
+    bool headless = false;
+    // Draw image size for headless rendering. Windowed rendering uses the window size
+    uint32_t width = 1920;
+    uint32_t height = 1080;
+    std::string scenePath = "../../resources/structure.glb";
+    // Transcoded KTX2 textures, created if it does not exist
+    std::string textureCachePath = "../../resources/texture_cache";
+    // Pipeline cache of the last run, only used if it was written by the same device and driver
+    std::string pipelineCachePath = "../../resources/pipeline_cache.bin";
+    // Meshes that quantize without visible loss are stored as CompactVertex. Scene packages keep the format they were cooked with
+    bool compactVertices = true;
+};
+
+struct FrameReadback {
+    int frameNumber;
+    VkExtent2D extent;
+    VkFormat format;
+    // Tightly packed pixels of the draw image, only valid during the callback
+    const void* data;
+    size_t size;
 };
 
 struct ComputePushConstants {
@@ -66,46 +139,139 @@ struct ComputeEffect {
     ComputePushConstants data;
 };
 
-struct RenderObject {
-    uint32_t indexCount;
-    uint32_t firstIndex;
-    VkBuffer indexBuffer;
-
-    MaterialInstance* material;
-
-    glm::mat4 transform;
-    VkDeviceAddress vertexBufferAddress;
+// Culling and LOD result of one object of the draw registry, kept until the object moves or the view changes
+struct ObjectVisibility {
+    bool visible;
+    bool simplified;
+    // Tested again this frame, its sort entry has to be built again
+    bool changed;
 };
 
 struct DrawContext {
-    std::vector<RenderObject> opaqueRenderObjects;
+    // Indexed like the draw registry's objects
+    std::vector<ObjectVisibility> visibility;
+    // Dense indices of the objects tested this frame
+    std::vector<uint32_t> changedObjects;
+    // Every object was tested, nothing of the previous sort order is kept
+    bool visibilityRebuilt = false;
+
+    // Surfaces outside the frustum are skipped, everything is drawn without one
+    std::optional<Frustum> frustum;
+    uint32_t visibleSurfaces;
+    uint32_t culledSurfaces;
+
+    // LOD selection: pixels covered by one unit at distance one, zero draws everything at full detail
+    glm::vec3 cameraPosition;
+    float lodPixelScale;
+    // Largest error on screen a simplified level may have, in pixels
+    float lodErrorThreshold;
+    uint32_t simplifiedSurfaces;
+};
+
+// Everything the whole visible set depends on. While none of it changes only the objects that moved are tested and sorted again
+struct VisibilityInputs {
+    glm::mat4 viewProjection;
+    bool frustumCulling;
+    float lodPixelScale;
+    float lodErrorThreshold;
+    uint64_t registryLayout;
+
+    bool operator==(const VisibilityInputs&) const = default;
 };
 
 class MeshNode final : public Node {
 public:
+    ~MeshNode() override { Unregister(); }
+
     std::shared_ptr<MeshAsset> mesh_;
 
-    void Draw(const glm::mat4& topMatrix, DrawContext& context) override;
+    // One draw per surface, they follow the node's world transform until Unregister
+    void Register(DrawRegistry& registry);
+
+    void Unregister() override;
+
+    void OnTransformChanged() override;
+
+private:
+    DrawRegistry* registry_ = nullptr;
+    DrawHandle drawHandle_ = DrawRegistry::kInvalidHandle;
 };
 
 constexpr unsigned int kFrameOverlap = 3;
+// Starting size of each frame's uniform allocator, it grows when a frame needs more
+constexpr VkDeviceSize kFrameUniformCapacity = 64 * 1024;
+
+// Direct draws are only split across recording threads when every chunk gets at least this many
+constexpr uint32_t kMinDrawsPerRecordingChunk = 256;
+
+// The meshlet cull pass dispatches one workgroup per object, in rows of at most this many. Every device supports 65535 per dimension
+constexpr uint32_t kMaxCullGroupsPerRow = 65535;
 
 class SrsVkRenderer {
 public:
-    void Init();
+    void Init(const RendererConfig& config = {});
 
     void Draw();
 
     void SpawnImguiWindow();
 
-    GpuMeshBuffers UploadMesh(std::span<uint32_t> indices, std::span<Vertex> vertices);
+    GpuMeshBuffers UploadMesh(std::span<const uint32_t> indices, std::span<const Vertex> vertices, std::span<const Meshlet> meshlets = {});
+
+    // Records the upload into the batch. The vertices are compacted if the mesh allows it and small meshes get 16 bit indices
+    GpuMeshBuffers UploadMesh(UploadBatch& batch, std::span<const uint32_t> indices, std::span<const Vertex> vertices, std::span<const Meshlet> meshlets = {});
+
+    // Vertices and indices are copied as they are, in the formats that come with them
+    GpuMeshBuffers UploadMesh(UploadBatch& batch, const IndexData& indices, const VertexData& vertices, std::span<const Meshlet> meshlets = {});
+
+    // Expects 4 bytes per pixel. A mipmapped image gets its mip chain blitted on the graphics queue before its first use
+    AllocatedImage CreateImage(UploadBatch& batch, const void* data, VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped = false);
+
+    // Block compressed images come with their mip levels
+    AllocatedImage CreateImage(UploadBatch& batch, const TranscodedTexture& texture, VkImageUsageFlags usage);
+
+    // Only for images no frame in flight uses anymore
+    void DestroyImage(const AllocatedImage& image) const;
+
+    UploadService& GetUploadService() { return uploadService_; }
+
+    TextureTranscoder& GetTextureTranscoder() { return textureTranscoder_; }
+
+    // Whether loaders should pack meshes as CompactVertex, see RendererConfig::compactVertices
+    [[nodiscard]] bool IsCompactVerticesEnabled() const { return compactVerticesEnabled_; }
+
+    // Scenes register their surfaces here once, every frame draws what is registered
+    DrawRegistry& GetDrawRegistry() { return drawRegistry_; }
+
+    // Returns the mesh's ranges to the arena once the frames in flight are done with them
+    void FreeMesh(const GpuMeshBuffers& mesh);
+
+    // Hands the sort key id of the material's descriptor set back, for materials whose set is about to be freed
+    void ReleaseMaterial(const MaterialInstance& material);
+
+    // Runs the function once the GPU has finished every frame recorded up to now, for resources the frames in flight may still use
+    void DeferDeletion(std::function<void()>&& function);
 
     AllocatedBuffer CreateBuffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage);
 
+    void DestroyBuffer(const AllocatedBuffer& buffer) const;
+
     void ResizeSwapChain();
 
     bool ResizeRequested();
 
+    // Headless only: called with the contents of the draw image kFrameOverlap frames after it was rendered, so reading back never stalls the frame
+    void SetReadbackCallback(std::function<void(const FrameReadback&)>&& callback);
+
+    [[nodiscard]] bool IsHeadless() const { return headless_; }
+
+    // Called with the timings of a frame once its GPU work has finished, kFrameOverlap frames after it was submitted
+    void SetFrameStatsCallback(std::function<void(const FrameStats&)>&& callback);
+
+    Camera& GetCamera() { return defaultCamera_; }
+
+    // Per pass GPU timings of the most recently completed frame
+    [[nodiscard]] std::span<const GpuPassTiming> GetGpuPassTimings() const { return gpuProfiler_.GetResults(); }
+
     void Shutdown();
 
     AllocatedImage whiteImage_{};
@@ -120,8 +286,8 @@ public:
     GltfMetallicRoughness metalRoughMaterial_{};
 
 private:
-    const std::vector<const char*> deviceExtensions_ = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+    // The swapchain extension is added in Init when rendering to a window
+    std::vector<const char*> deviceExtensions_ = {
         VK_EXT_SHADER_OBJECT_EXTENSION_NAME
     };
 
@@ -138,6 +304,8 @@ private:
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        // A family with transfer but without graphics support, usually backed by DMA engines. Optional
+        std::optional<uint32_t> transferFamily;
 
         [[nodiscard]] bool IsComplete() const {
             return graphicsFamily.has_value() && presentFamily.has_value();
@@ -165,6 +333,8 @@ private:
 
     void CreateSwapChain(uint32_t width, uint32_t height);
 
+    void CreateDrawImages(uint32_t width, uint32_t height);
+
     void DestroySwapChain();
 
     static VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
@@ -177,6 +347,8 @@ private:
 
     void InitCommandBuffers();
 
+    void InitUploadService();
+
     void InitSyncObjects();
 
     void InitAllocator();
@@ -189,28 +361,77 @@ private:
 
     void InitMeshPipeline();
 
+    void InitCullPipeline();
+
     void InitDefaultData();
 
     void InitImgui();
 
+    void InitReadback();
+
+    void RecordReadback(VkCommandBuffer cmd);
+
+    void DeliverReadback(FrameData& frame);
+
+    void InitGpuProfiler();
+
+    void DeliverFrameStats(uint32_t frameIndex);
+
+    // Runs the deferred deletions of every frame up to and including completedFrame
+    void FlushDeferredDeletions(int completedFrame);
+
     void DrawImgui(VkCommandBuffer cmd, VkImageView targetImageView);
 
     void DrawBackground(VkCommandBuffer cmd);
 
     void DrawGeometry(VkCommandBuffer cmd);
 
-    void UpdateScene();
+    // Frustum culls the registered objects and picks their LODs. While the visibility inputs stay the same only the moved groups are tested
+    void CollectVisibleObjects();
 
+    // Culls one group of the registry, a group outside the frustum rejects all of its objects
+    void CollectVisibleGroup(const DrawGroup& group);
 
-    void DestroyBuffer(const AllocatedBuffer& buffer) const;
+    // Keeps drawSortEntries_ ordered by sort key: the entries of the objects tested this frame are built again and merged into the others
+    void SortDrawObjects();
 
-    AllocatedImage CreateImage(VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped = false);
+    // Fills drawBatches_ from the sorted draws and writes the world matrices into this frame's instance buffer. Draws of the same surface
+    // and material are only merged within a run of equal state, so the batches keep the order of the sort
+    void BuildDrawBatches();
 
-    AllocatedImage CreateImage(void* data, VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped = false);
+    void SetViewportAndScissor(VkCommandBuffer cmd) const;
 
-    void DestroyImage(const AllocatedImage& image) const;
+    // Records the given slice of the batches, one draw call per batch, binding only when the state changes. Counts into stats
+    void DrawDirect(VkCommandBuffer cmd, VkDescriptorSet globalDescriptor, std::span<const DrawBatch> batches, FrameStats& stats);
+
+    // Records the draws into secondary command buffers on the job system threads and executes them inside the current rendering scope
+    void DrawDirectParallel(VkCommandBuffer cmd, VkDescriptorSet globalDescriptor, uint32_t chunkCount);
+
+    // Number of secondary command buffers the direct draws are split into, 0 records them into the primary command buffer
+    [[nodiscard]] uint32_t GetRecordingChunkCount() const;
 
-    void ImmediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function);
+    // Uploads the object data and records the compute pass that frustum culls it into indirect commands. With meshlet culling every object is
+    // culled meshlet by meshlet and its visible triangles are copied into the compacted index buffer the indirect draws read
+    void RecordGpuCulling(VkCommandBuffer cmd);
+
+    // One indirect count draw per bucket of objects with the same state
+    void DrawIndirect(VkCommandBuffer cmd, VkDescriptorSet globalDescriptor);
+
+    void EnsureIndirectCapacity(FrameData& frame, uint32_t objectCount);
+
+    void EnsureCompactedIndexCapacity(FrameData& frame, uint32_t indexCount);
+
+    void DestroyIndirectBuffers(FrameData& frame) const;
+
+    VkDeviceAddress GetBufferAddress(VkBuffer buffer) const;
+
+    void UpdateScene();
+
+    AllocatedImage CreateImage(VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped = false);
+
+    AllocatedImage CreateImage(VkExtent3D size, VkFormat format, VkImageUsageFlags usage, uint32_t mipLevels);
+
+    AllocatedImage CreateImage(const void* data, VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped = false);
 
     FrameData& GetCurrentFrame() { return frames_[frameNumber_ % kFrameOverlap]; }
 
@@ -219,6 +440,10 @@ private:
     VkSurfaceKHR surface_ = VK_NULL_HANDLE;
     VkQueue graphicsQueue_ = VK_NULL_HANDLE;
     VkQueue presentQueue_ = VK_NULL_HANDLE;
+    // Falls back to the graphics queue without a dedicated transfer family
+    VkQueue transferQueue_ = VK_NULL_HANDLE;
+    uint32_t graphicsFamily_ = 0;
+    uint32_t transferFamily_ = 0;
     VkSwapchainKHR swapChain_ = VK_NULL_HANDLE;
     std::vector<VkImage> swapChainImages_;
     std::vector<VkImageView> swapChainImageViews_;
@@ -226,11 +451,6 @@ private:
     VkExtent2D swapChainExtent_ = {};
     std::vector<VkSemaphore> submitSemaphores_;
 
-    // immediate submit structures
-    VkFence immFence_{};
-    VkCommandBuffer immCommandBuffer_{};
-    VkCommandPool immCommandPool_{};
-
     VmaAllocator allocator_ = nullptr;
     AllocatedImage drawImage_{};
     VkExtent2D drawExtent_{};
@@ -256,10 +476,39 @@ private:
 
     bool resizeRequested_ = false;
 
+    bool headless_ = false;
+    bool validationEnabled_ = false;
+    bool frustumCullingEnabled_ = true;
+    bool drawIndirectCountSupported_ = false;
+    VkPhysicalDeviceFeatures enabledFeatures_{};
+    bool gpuDrivenEnabled_ = true;
+    bool parallelRecordingEnabled_ = true;
+    bool compactVerticesEnabled_ = true;
+    bool meshletCullingEnabled_ = true;
+    bool lodEnabled_ = true;
+    bool instancingEnabled_ = true;
+    // Below a pixel the switch between two levels is not visible
+    float lodErrorPixels_ = 1.0f;
+    std::function<void(const FrameReadback&)> readbackCallback_;
+
+    std::string scenePath_;
+    std::string textureCachePath_;
+    std::string pipelineCachePath_;
+    PipelineCache pipelineCache_;
+    GpuProfiler gpuProfiler_;
+    std::function<void(const FrameStats&)> frameStatsCallback_;
 
     bool isInitialized_ = false;
 
     int frameNumber_{0};
+
+    struct DeferredDeletion {
+        // Last frame that may still use the resource
+        int frameNumber;
+        std::function<void()> function;
+    };
+    std::deque<DeferredDeletion> deferredDeletions_;
+
     FrameData frames_[kFrameOverlap]{};
 
     std::vector<ComputeEffect> computeEffects_{};
@@ -271,8 +520,38 @@ private:
 
     MaterialInstance defaultMaterialData_{};
 
+    MeshArena meshArena_;
+    UploadService uploadService_;
+    TextureTranscoder textureTranscoder_;
+    ParallelRecorder parallelRecorder_;
+    std::vector<FrameStats> chunkStats_;
+
+    DrawRegistry drawRegistry_;
     DrawContext mainDrawContext_;
+    std::optional<VisibilityInputs> visibilityInputs_;
+    SortKeyIds pipelineIds_{kPipelineIdBits};
+    SortKeyIds materialIds_{kMaterialIdBits};
+    SortKeyIds indexBufferIds_{kIndexBufferIdBits};
+    std::vector<DrawSortEntry> drawSortEntries_;
+    std::vector<DrawSortEntry> drawSortChanged_;
+    std::vector<DrawSortEntry> drawSortScratch_;
+    std::vector<DrawBatch> drawBatches_;
+    std::vector<uint32_t> drawBatchOfEntry_;
+    std::unordered_map<InstanceKey, uint32_t, InstanceKeyHash> drawBatchLookup_;
+    VkDeviceAddress instanceBufferAddress_ = 0;
+
+    struct IndirectBucket {
+        uint32_t firstEntry;
+        uint32_t count;
+    };
+    std::vector<IndirectBucket> indirectBuckets_;
+
+    VkPipeline cullPipeline_;
+    VkPipelineLayout cullPipelineLayout_;
+    VkPipeline meshletCullPipeline_;
+    VkPipelineLayout meshletCullPipelineLayout_;
     std::unordered_map<std::string, std::shared_ptr<Node>> loadedNodes_;
+    TransformHierarchy testNodeTransforms_;
     std::unordered_map<std::string, std::shared_ptr<LoadedGltf>> loadedScenes_;
 
     Camera defaultCamera_{};
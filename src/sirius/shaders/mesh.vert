@@ -4,40 +4,37 @@
 #extension GL_EXT_buffer_reference : require
 
 #include "input_structures.glsl"
+#include "vertex.glsl"
 
 layout (location = 0) out vec3 outNormal;
 layout (location = 1) out vec3 outColor;
 layout (location = 2) out vec2 outUV;
 
-struct Vertex {
-
-    vec3 position;
-    float uv_x;
-    vec3 normal;
-    float uv_y;
-    vec4 color;
-};
-
-layout(buffer_reference, std430) readonly buffer VertexBuffer{
-    Vertex vertices[];
+// World matrices of the instances, firstInstance points at the draw's first one
+layout(buffer_reference, std430) readonly buffer InstanceBuffer{
+    mat4 transforms[];
 };
 
 //push constants block
 layout( push_constant ) uniform constants
 {
-    mat4 render_matrix;
     VertexBuffer vertexBuffer;
+    InstanceBuffer instanceBuffer;
+    uint vertexFormat;
+    vec4 positionOffset; // xyz maps compact positions back to mesh space
+    vec4 positionScale;
 } PushConstants;
 
 void main()
 {
-    Vertex v = PushConstants.vertexBuffer.vertices[gl_VertexIndex];
+    Vertex v = LoadVertex(PushConstants.vertexBuffer, PushConstants.vertexFormat, PushConstants.positionOffset.xyz, PushConstants.positionScale.xyz, gl_VertexIndex);
 
+    mat4 transform = PushConstants.instanceBuffer.transforms[gl_InstanceIndex];
     vec4 position = vec4(v.position, 1.0f);
 
-    gl_Position =  sceneData.viewproj * PushConstants.render_matrix *position;
+    gl_Position =  sceneData.viewproj * transform * position;
 
-    outNormal = (PushConstants.render_matrix * vec4(v.normal, 0.f)).xyz;
+    outNormal = (transform * vec4(v.normal, 0.f)).xyz;
     outColor = v.color.xyz * materialData.colorFactors.xyz;
     outUV.x = v.uv_x;
     outUV.y = v.uv_y;
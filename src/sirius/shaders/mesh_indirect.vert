@@ -0,0 +1,33 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_buffer_reference : require
+
+#include "input_structures.glsl"
+#include "object_data.glsl"
+
+layout (location = 0) out vec3 outNormal;
+layout (location = 1) out vec3 outColor;
+layout (location = 2) out vec2 outUV;
+
+// Same range as the push constants of mesh.vert, only the start is used
+layout( push_constant ) uniform constants
+{
+    ObjectBuffer objectBuffer;
+} PushConstants;
+
+void main()
+{
+    // The cull shader stores the object index as first instance
+    ObjectData object = PushConstants.objectBuffer.objects[gl_InstanceIndex];
+    Vertex v = LoadVertex(object.vertexBuffer, object.vertexFormat, object.positionOffset.xyz, object.positionScale.xyz, gl_VertexIndex);
+
+    vec4 position = vec4(v.position, 1.0f);
+
+    gl_Position =  sceneData.viewproj * object.transform * position;
+
+    outNormal = (object.transform * vec4(v.normal, 0.f)).xyz;
+    outColor = v.color.xyz * materialData.colorFactors.xyz;
+    outUV.x = v.uv_x;
+    outUV.y = v.uv_y;
+}
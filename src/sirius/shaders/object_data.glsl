@@ -0,0 +1,46 @@
+#include "vertex.glsl"
+
+// Matches Meshlet
+struct Meshlet {
+    vec4 sphere; // mesh space, w is the radius
+    vec4 cone; // w is the cutoff
+    uint firstIndex; // relative to the surface's first index
+    uint triangleCount;
+    uint padding0;
+    uint padding1;
+};
+
+layout(buffer_reference, std430) readonly buffer MeshletBuffer{
+    Meshlet meshlets[];
+};
+
+// 16-bit index buffers are read two indices per word
+layout(buffer_reference, std430) readonly buffer IndexWords{
+    uint words[];
+};
+
+// Everything the GPU needs to cull and draw one object, matches GpuObjectData
+struct ObjectData {
+    mat4 transform;
+    vec4 boundsOrigin; // w is the bounding sphere radius
+    vec4 boundsExtents;
+    vec4 positionOffset; // xyz maps compact positions back to mesh space
+    vec4 positionScale;
+    uint indexCount;
+    uint firstIndex;
+    uint bucket;
+    uint bucketBase;
+    VertexBuffer vertexBuffer;
+    int vertexOffset;
+    uint vertexFormat;
+    MeshletBuffer meshletBuffer;
+    IndexWords indexBuffer;
+    uint meshletCount;
+    uint compactedFirstIndex;
+    uint indexType; // VkIndexType
+    uint coneCulling;
+};
+
+layout(buffer_reference, std430) readonly buffer ObjectBuffer{
+    ObjectData objects[];
+};
@@ -0,0 +1,55 @@
+#ifndef VERTEX_GLSL
+#define VERTEX_GLSL
+
+// Matches Vertex
+struct Vertex {
+
+    vec3 position;
+    float uv_x;
+    vec3 normal;
+    float uv_y;
+    vec4 color;
+};
+
+layout(buffer_reference, std430) readonly buffer VertexBuffer{
+    Vertex vertices[];
+};
+
+// Matches CompactVertex: unorm16 position xy, unorm16 position z with a snorm8 octahedral normal, half float uv, unorm8 color
+layout(buffer_reference, std430) readonly buffer CompactVertexBuffer{
+    uvec4 vertices[];
+};
+
+// Matches VertexFormat
+const uint VERTEX_FORMAT_FULL = 0;
+const uint VERTEX_FORMAT_COMPACT = 1;
+
+vec3 DecodeOctahedral(vec2 encoded)
+{
+    vec3 normal = vec3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0f);
+    normal.x += normal.x >= 0.0f ? -fold : fold;
+    normal.y += normal.y >= 0.0f ? -fold : fold;
+    return normalize(normal);
+}
+
+// Both formats come out as a full vertex in mesh space. The format is the same for the whole draw, so the branch does not diverge
+Vertex LoadVertex(VertexBuffer buffer, uint format, vec3 positionOffset, vec3 positionScale, int index)
+{
+    if (format != VERTEX_FORMAT_COMPACT) {
+        return buffer.vertices[index];
+    }
+
+    uvec4 packed = CompactVertexBuffer(buffer).vertices[index];
+    vec2 uv = unpackHalf2x16(packed.z);
+
+    Vertex v;
+    v.position = vec3(unpackUnorm2x16(packed.x), unpackUnorm2x16(packed.y).x) * positionScale + positionOffset;
+    v.normal = DecodeOctahedral(unpackSnorm4x8(packed.y).zw);
+    v.uv_x = uv.x;
+    v.uv_y = uv.y;
+    v.color = unpackUnorm4x8(packed.w);
+    return v;
+}
+
+#endif
@@ -0,0 +1,239 @@
+//
+// Created by Leon on 17/10/2026.
+//
+
+// Unit tests of the job system, needs no GPU. Returns non-zero if a check fails.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "core/jobs.h"
+
+namespace {
+int failures = 0;
+
+#define CHECK(condition)                                                          \
+do {                                                                              \
+if (!(condition)) {                                                               \
+fmt::print("{}:{}: CHECK failed: {}\n", __FILE__, __LINE__, #condition);          \
+failures++;                                                                       \
+}                                                                                 \
+} while (0)
+
+// Long enough that the other threads get the chance to steal the remaining jobs
+void Sleep() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+void TestRunsInlineWithoutInit() {
+    sirius::JobCounter counter;
+    const std::thread::id caller = std::this_thread::get_id();
+    std::thread::id ranOn;
+    sirius::JobSystem::Run([&] { ranOn = std::this_thread::get_id(); }, &counter);
+
+    CHECK(counter.IsDone());
+    CHECK(ranOn == caller);
+}
+
+void TestWait() {
+    constexpr uint32_t kJobCount = 256;
+    sirius::JobCounter counter;
+    std::atomic<uint32_t> finished{0};
+    for (uint32_t i = 0; i < kJobCount; i++) {
+        sirius::JobSystem::Run([&] {
+            if (finished.load() % 32 == 0) {
+                Sleep();
+            }
+            finished.fetch_add(1);
+        }, &counter);
+    }
+    sirius::JobSystem::Wait(counter);
+
+    CHECK(counter.IsDone());
+    CHECK(finished.load() == kJobCount);
+
+    // Waiting on a counter that is already done returns right away
+    sirius::JobSystem::Wait(counter);
+    CHECK(counter.IsDone());
+}
+
+void TestRunAfterOrdering() {
+    constexpr uint32_t kFanIn = 64;
+    constexpr uint32_t kChainLength = 64;
+
+    // The dependent starts only once every job of the dependency has finished
+    sirius::JobCounter first;
+    sirius::JobCounter second;
+    std::atomic<uint32_t> finished{0};
+    uint32_t finishedBeforeDependent = 0;
+    for (uint32_t i = 0; i < kFanIn; i++) {
+        sirius::JobSystem::Run([&] {
+            Sleep();
+            finished.fetch_add(1);
+        }, &first);
+    }
+    sirius::JobSystem::RunAfter(first, [&] { finishedBeforeDependent = finished.load(); }, &second);
+    sirius::JobSystem::Wait(second);
+    CHECK(finishedBeforeDependent == kFanIn);
+
+    // A chain runs in order
+    std::vector<sirius::JobCounter> counters(kChainLength);
+    std::mutex mutex;
+    std::vector<uint32_t> order;
+    sirius::JobSystem::Run([&] {
+        Sleep();
+        std::lock_guard lock(mutex);
+        order.push_back(0);
+    }, &counters[0]);
+    for (uint32_t i = 1; i < kChainLength; i++) {
+        sirius::JobSystem::RunAfter(counters[i - 1], [&, i] {
+            std::lock_guard lock(mutex);
+            order.push_back(i);
+        }, &counters[i]);
+    }
+    sirius::JobSystem::Wait(counters.back());
+    CHECK(order.size() == kChainLength);
+    CHECK(std::ranges::is_sorted(order));
+
+    // A dependency that is already done starts the job right away
+    sirius::JobCounter done;
+    sirius::JobCounter third;
+    bool ran = false;
+    sirius::JobSystem::RunAfter(done, [&] { ran = true; }, &third);
+    sirius::JobSystem::Wait(third);
+    CHECK(ran);
+}
+
+void TestParallelForCoverage() {
+    struct Case {
+        uint32_t count;
+        uint32_t grainSize;
+    };
+    constexpr Case kCases[] = {{0, 16}, {1, 16}, {15, 16}, {16, 16}, {17, 16}, {1000, 1}, {1000, 0}, {100000, 333}, {4096, 100000}};
+
+    for (const auto& [count, grainSize] : kCases) {
+        std::vector<std::atomic<uint32_t>> hits(count);
+        sirius::JobSystem::ParallelFor(count, grainSize, [&](uint32_t begin, uint32_t end) {
+            CHECK(begin < end);
+            CHECK(end <= count);
+            for (uint32_t i = begin; i < end; i++) {
+                hits[i].fetch_add(1);
+            }
+        });
+
+        const bool everyIndexOnce = std::ranges::all_of(hits, [](const std::atomic<uint32_t>& hit) { return hit.load() == 1; });
+        if (!everyIndexOnce) {
+            fmt::print("ParallelFor missed or repeated an index with count {} and grain size {}\n", count, grainSize);
+        }
+        CHECK(everyIndexOnce);
+    }
+}
+
+void TestMainThreadAffinity() {
+    constexpr uint32_t kJobCount = 64;
+    const std::thread::id mainThread = std::this_thread::get_id();
+
+    // Queued from workers, so only the main thread picking them up can run them
+    sirius::JobCounter scheduled;
+    sirius::JobCounter mainThreadJobs;
+    std::atomic<uint32_t> ranOnMain{0};
+    std::atomic<uint32_t> ranElsewhere{0};
+    for (uint32_t i = 0; i < kJobCount; i++) {
+        sirius::JobSystem::Run([&] {
+            sirius::JobSystem::Run([&] {
+                (std::this_thread::get_id() == mainThread && sirius::JobSystem::IsMainThread() ? ranOnMain : ranElsewhere).fetch_add(1);
+            }, &mainThreadJobs, sirius::JobAffinity::MainThread);
+        }, &scheduled);
+    }
+    sirius::JobSystem::Wait(scheduled);
+    sirius::JobSystem::Wait(mainThreadJobs);
+    CHECK(ranOnMain.load() == kJobCount);
+    CHECK(ranElsewhere.load() == 0);
+
+    // RunMainThreadJobs runs what is queued
+    bool ran = false;
+    sirius::JobSystem::Run([&] { ran = std::this_thread::get_id() == mainThread; }, nullptr, sirius::JobAffinity::MainThread);
+    sirius::JobSystem::RunMainThreadJobs();
+    CHECK(ran);
+}
+
+void TestStealingUnderLoad() {
+    constexpr uint32_t kJobCount = 128;
+
+    // Every job goes into the queue of the worker that spawns them, the other threads can only get them by stealing
+    sirius::JobCounter spawner;
+    sirius::JobCounter jobs;
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::thread::id spawnerThread;
+    sirius::JobSystem::Run([&] {
+        spawnerThread = std::this_thread::get_id();
+        for (uint32_t i = 0; i < kJobCount; i++) {
+            sirius::JobSystem::Run([&] {
+                Sleep();
+                std::lock_guard lock(mutex);
+                threads.insert(std::this_thread::get_id());
+            }, &jobs);
+        }
+    }, &spawner);
+    sirius::JobSystem::Wait(spawner);
+    sirius::JobSystem::Wait(jobs);
+
+    threads.erase(spawnerThread);
+    CHECK(!threads.empty());
+    // The main thread and at least one other worker stole from the busy worker
+    CHECK(threads.size() >= std::min<size_t>(2, sirius::JobSystem::GetWorkerCount()));
+}
+
+void TestShutdownRunsPendingJobs() {
+    constexpr uint32_t kJobCount = 64;
+
+    // Queued jobs, a dependent that is still waiting and the main thread job it queues all run before Shutdown returns
+    sirius::JobSystem::Init(3);
+    sirius::JobCounter dependency;
+    std::atomic<uint32_t> finished{0};
+    for (uint32_t i = 0; i < kJobCount; i++) {
+        sirius::JobSystem::Run([&] {
+            Sleep();
+            finished.fetch_add(1);
+        }, &dependency);
+    }
+    sirius::JobSystem::RunAfter(dependency, [&] {
+        finished.fetch_add(1);
+        sirius::JobSystem::Run([&] { finished.fetch_add(1); }, nullptr, sirius::JobAffinity::MainThread);
+    });
+    sirius::JobSystem::Shutdown();
+
+    CHECK(finished.load() == kJobCount + 2);
+    CHECK(dependency.IsDone());
+}
+}
+
+int main() {
+    TestRunsInlineWithoutInit();
+
+    sirius::JobSystem::Init(3);
+    TestWait();
+    TestRunAfterOrdering();
+    TestParallelForCoverage();
+    TestMainThreadAffinity();
+    TestStealingUnderLoad();
+    sirius::JobSystem::Shutdown();
+
+    TestShutdownRunsPendingJobs();
+    TestRunsInlineWithoutInit();
+
+    if (failures > 0) {
+        fmt::print("{} checks failed\n", failures);
+        return 1;
+    }
+    fmt::print("All job system tests passed\n");
+    return 0;
+}